@@ -0,0 +1,59 @@
+#include <algorithm>
+#include "async_search_server.h"
+
+using namespace std;
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, size_t queue_capacity, size_t worker_count)
+    : search_server_(search_server)
+    , queue_(queue_capacity) {
+    //hardware_concurrency может вернуть 0
+    worker_count = max<size_t>(worker_count, 1);
+    workers_.reserve(worker_count);
+    try {
+        for (size_t i = 0; i < worker_count; ++i) {
+            workers_.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+    catch (...) {
+        //деструктор не вызовется: уже запущенные потоки нужно остановить здесь, иначе ~thread вызовет terminate
+        StopWorkers();
+        throw;
+    }
+}
+
+AsyncSearchServer::~AsyncSearchServer() {
+    StopWorkers();
+}
+
+optional<future<vector<Document>>> AsyncSearchServer::SubmitFind(string raw_query) {
+    return SubmitFind(move(raw_query), DocumentStatus::ACTUAL);
+}
+
+optional<future<MatchOfDocument>> AsyncSearchServer::SubmitMatch(string raw_query, int document_id) {
+    return Submit([raw_query = move(raw_query), document_id](const SearchServer& search_server) {
+        return search_server.MatchDocument(raw_query, document_id);
+    });
+}
+
+size_t AsyncSearchServer::GetQueueSize() const {
+    return queue_.Size();
+}
+
+size_t AsyncSearchServer::GetRejectedCount() const {
+    return rejected_count_;
+}
+
+void AsyncSearchServer::WorkerLoop() {
+    Job job;
+    //исключения запроса попадают в его future, поток продолжает работу
+    while (queue_.Pop(job)) {
+        job();
+    }
+}
+
+void AsyncSearchServer::StopWorkers() {
+    queue_.Close();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <future>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "search_server.h"
+#include "bounded_queue.h"
+
+// Асинхронный вход в SearchServer: запросы ставятся в ограниченную очередь и выполняются
+// фиксированным пулом потоков, вызывающий получает future с результатом.
+// Если очередь заполнена, запрос отклоняется сразу (пустой optional) - сервис сам решает, повторить его или отказать клиенту.
+// Сервер не должен изменяться, пока AsyncSearchServer существует. Деструктор дожидается выполнения принятых запросов.
+class AsyncSearchServer {
+public:
+    AsyncSearchServer(const SearchServer& search_server, size_t queue_capacity,
+        size_t worker_count = std::thread::hardware_concurrency());
+    ~AsyncSearchServer();
+
+    AsyncSearchServer(const AsyncSearchServer&) = delete;
+    AsyncSearchServer& operator=(const AsyncSearchServer&) = delete;
+
+    // произвольная работа с сервером: function(const SearchServer&)
+    template <typename Function>
+    std::optional<std::future<std::invoke_result_t<Function, const SearchServer&>>> Submit(Function function) {
+        using Result = std::invoke_result_t<Function, const SearchServer&>;
+        std::packaged_task<Result()> task([&search_server = search_server_, function = std::move(function)]() mutable {
+            return function(search_server);
+        });
+        auto future = task.get_future();
+        //packaged_task перемещаемый, обёртка стирает тип результата
+        Job job([task = std::move(task)]() mutable { task(); });
+        if (!queue_.TryPush(job)) {
+            ++rejected_count_;
+            return std::nullopt;
+        }
+        return future;
+    }
+
+    template <typename DocumentPredicate>
+    std::optional<std::future<std::vector<Document>>> SubmitFind(std::string raw_query, DocumentPredicate document_predicate) {
+        return Submit([raw_query = std::move(raw_query), document_predicate](const SearchServer& search_server) {
+            return search_server.FindTopDocuments(raw_query, document_predicate);
+        });
+    }
+
+    std::optional<std::future<std::vector<Document>>> SubmitFind(std::string raw_query);
+    std::optional<std::future<MatchOfDocument>> SubmitMatch(std::string raw_query, int document_id);
+
+    size_t GetQueueSize() const;
+    size_t GetRejectedCount() const;
+
+private:
+    using Job = std::packaged_task<void()>;
+
+    void WorkerLoop();
+    // закрывает очередь и дожидается запущенных рабочих потоков
+    void StopWorkers();
+
+    const SearchServer& search_server_;
+    BoundedQueue<Job> queue_;
+    std::atomic<size_t> rejected_count_ = 0;
+    std::vector<std::thread> workers_;
+};
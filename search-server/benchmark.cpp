@@ -0,0 +1,450 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <execution>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "async_search_server.h"
+#include "generator.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+
+// Замеры производительности на синтетическом корпусе с распределением слов по Ципфу.
+// Корпус и запросы строятся из seed, поэтому при одинаковых параметрах запуски сравнимы между коммитами.
+// Каждая операция прогоняется warmup раз без учёта и repetitions раз с замером, результат - JSON:
+//
+//  benchmark --documents 50000 --zipf 1.0 --repetitions 10 --output result.json
+
+namespace {
+    struct BenchmarkConfig {
+        unsigned seed = 42;
+        int dictionary_size = 20000;
+        int max_word_length = 10;
+        int document_count = 10000;
+        int max_document_words = 80;
+        //длины документов - логнормальные около median_document_words
+        int median_document_words = 30;
+        double document_length_sigma = 0.8;
+        double zipf_exponent = 1.0;
+        int query_count = 500;
+        int max_query_words = 5;
+        double minus_word_probability = 0.1;
+        int match_document_count = 100;
+        int shard_count = 4;
+        //RemoveDuplicates квадратичен по числу документов - у него свой корпус поменьше
+        int duplicate_document_count = 2000;
+        int warmup = 1;
+        int repetitions = 5;
+        //журнал запросов вместо сгенерированных запросов, см. ReadQueryLog; ещё и воспроизводится с исходными паузами
+        std::string query_log;
+        double replay_speedup = 1.0;
+        std::string filter; //подстрока имени: запускать только подходящие замеры
+        std::string output; //пусто - stdout
+    };
+
+    struct BenchmarkResult {
+        std::string name;
+        size_t operations = 0; //операций в одном повторе
+        std::vector<uint64_t> durations_ns;
+    };
+
+    // сумма результатов: не даёт компилятору выбросить замеряемый код
+    volatile size_t benchmark_sink = 0;
+
+    void Consume(size_t value) {
+        benchmark_sink = benchmark_sink + value;
+    }
+
+    class BenchmarkRunner {
+    public:
+        explicit BenchmarkRunner(const BenchmarkConfig& config)
+            : config_(config) {
+        }
+
+        // setup() готовит состояние вне замера, run(state) - замеряемая часть, operations - число операций в run
+        template <typename Setup, typename Measured>
+        void Run(const std::string& name, size_t operations, Setup setup, Measured run) {
+            if (name.find(config_.filter) == std::string::npos) {
+                return;
+            }
+            BenchmarkResult result{ name, operations, {} };
+            for (int i = 0; i < config_.warmup + config_.repetitions; ++i) {
+                auto state = setup();
+                const auto start = std::chrono::steady_clock::now();
+                run(state);
+                const auto duration = std::chrono::steady_clock::now() - start;
+                if (i >= config_.warmup) {
+                    result.durations_ns.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+                }
+            }
+            std::cerr << name << ": "s << Median(result.durations_ns) / 1000000.0 << " ms"s << std::endl;
+            results_.push_back(std::move(result));
+        }
+
+        void WriteJson(std::ostream& out) const {
+            out << "{\n  \"config\": {"s
+                << "\"seed\": "s << config_.seed
+                << ", \"dictionary_size\": "s << config_.dictionary_size
+                << ", \"document_count\": "s << config_.document_count
+                << ", \"max_document_words\": "s << config_.max_document_words
+                << ", \"median_document_words\": "s << config_.median_document_words
+                << ", \"document_length_sigma\": "s << config_.document_length_sigma
+                << ", \"zipf_exponent\": "s << config_.zipf_exponent
+                << ", \"query_count\": "s << config_.query_count
+                << ", \"max_query_words\": "s << config_.max_query_words
+                << ", \"minus_word_probability\": "s << config_.minus_word_probability
+                << ", \"query_log\": "s << JsonString(config_.query_log)
+                << ", \"replay_speedup\": "s << config_.replay_speedup
+                << ", \"shard_count\": "s << config_.shard_count
+                << ", \"warmup\": "s << config_.warmup
+                << ", \"repetitions\": "s << config_.repetitions << "},\n  \"results\": ["s;
+            bool first = true;
+            for (const auto& result : results_) {
+                const auto [min_it, max_it] = std::minmax_element(result.durations_ns.begin(), result.durations_ns.end());
+                const uint64_t median = Median(result.durations_ns);
+                const double mean = std::accumulate(result.durations_ns.begin(), result.durations_ns.end(), 0.0) / result.durations_ns.size();
+                out << (first ? "\n    {"s : ",\n    {"s)
+                    << "\"name\": "s << JsonString(result.name)
+                    << ", \"operations\": "s << result.operations
+                    << ", \"min_ns\": "s << *min_it
+                    << ", \"median_ns\": "s << median
+                    << ", \"mean_ns\": "s << static_cast<uint64_t>(mean)
+                    << ", \"max_ns\": "s << *max_it
+                    << ", \"median_ns_per_operation\": "s << (result.operations == 0 ? 0.0 : static_cast<double>(median) / result.operations)
+                    << '}';
+                first = false;
+            }
+            out << "\n  ]\n}\n"s;
+        }
+
+    private:
+        //строка в кавычках; путь к журналу запросов задаёт пользователь, в нём могут быть кавычки и обратные косые
+        static std::string JsonString(std::string_view text) {
+            std::string result = "\""s;
+            for (const char c : text) {
+                if (c == '"' || c == '\\') {
+                    result += '\\';
+                    result += c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    const char* digits = "0123456789abcdef";
+                    result += "\\u00"s;
+                    result += digits[c >> 4];
+                    result += digits[c & 0xf];
+                } else {
+                    result += c;
+                }
+            }
+            result += '"';
+            return result;
+        }
+
+        static uint64_t Median(std::vector<uint64_t> values) {
+            if (values.empty()) {
+                return 0;
+            }
+            std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+            return values[values.size() / 2];
+        }
+
+        const BenchmarkConfig& config_;
+        std::vector<BenchmarkResult> results_;
+    };
+
+    BenchmarkConfig ParseArguments(int argc, char* argv[]) {
+        BenchmarkConfig config;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view argument = argv[i];
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for "s + std::string(argument));
+            }
+            const std::string value = argv[++i];
+            if (argument == "--seed"sv) {
+                config.seed = static_cast<unsigned>(std::stoul(value));
+            } else if (argument == "--dictionary"sv) {
+                config.dictionary_size = std::stoi(value);
+            } else if (argument == "--documents"sv) {
+                config.document_count = std::stoi(value);
+            } else if (argument == "--document-words"sv) {
+                config.max_document_words = std::stoi(value);
+            } else if (argument == "--median-document-words"sv) {
+                config.median_document_words = std::stoi(value);
+            } else if (argument == "--length-sigma"sv) {
+                config.document_length_sigma = std::stod(value);
+            } else if (argument == "--zipf"sv) {
+                config.zipf_exponent = std::stod(value);
+            } else if (argument == "--queries"sv) {
+                config.query_count = std::stoi(value);
+            } else if (argument == "--query-words"sv) {
+                config.max_query_words = std::stoi(value);
+            } else if (argument == "--minus-probability"sv) {
+                config.minus_word_probability = std::stod(value);
+            } else if (argument == "--query-log"sv) {
+                config.query_log = value;
+            } else if (argument == "--replay-speedup"sv) {
+                config.replay_speedup = std::stod(value);
+            } else if (argument == "--shards"sv) {
+                config.shard_count = std::stoi(value);
+            } else if (argument == "--duplicate-documents"sv) {
+                config.duplicate_document_count = std::stoi(value);
+            } else if (argument == "--warmup"sv) {
+                config.warmup = std::stoi(value);
+            } else if (argument == "--repetitions"sv) {
+                config.repetitions = std::stoi(value);
+            } else if (argument == "--filter"sv) {
+                config.filter = value;
+            } else if (argument == "--output"sv) {
+                config.output = value;
+            } else {
+                throw std::invalid_argument("Unknown option "s + std::string(argument));
+            }
+        }
+        if (config.document_count <= 0 || config.dictionary_size <= 0 || config.median_document_words <= 0 || config.repetitions <= 0 || config.warmup < 0 || config.replay_speedup <= 0 || config.shard_count <= 0) {
+            throw std::invalid_argument("Sizes and repetitions must be positive"s);
+        }
+        return config;
+    }
+
+    std::unique_ptr<SearchServer> BuildServer(const std::vector<std::string>& documents, SearchServerOptions options = {}) {
+        auto search_server = std::make_unique<SearchServer>(""s, options);
+        for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+            search_server->AddDocument(id, documents[id], DocumentStatus::ACTUAL, { id % 10, 5 });
+        }
+        return search_server;
+    }
+
+    template <typename ExecutionPolicy>
+    void RunFindTopDocuments(const SearchServer& search_server, const std::vector<std::string>& queries, ExecutionPolicy policy) {
+        for (const auto& query : queries) {
+            Consume(search_server.FindTopDocuments(policy, query).size());
+        }
+    }
+
+    void RunBenchmarks(const BenchmarkConfig& config, BenchmarkRunner& runner) {
+        std::mt19937 generator(config.seed);
+        const auto dictionary = GenerateDictionary(generator, config.dictionary_size, config.max_word_length);
+        const DocumentLengthDistribution length_distribution(config.median_document_words, config.document_length_sigma, config.max_document_words);
+        const auto documents = GenerateDocuments(generator, dictionary, config.document_count, length_distribution, config.zipf_exponent);
+        std::vector<LoggedQuery> query_log;
+        std::vector<std::string> queries;
+        if (config.query_log.empty()) {
+            queries = GenerateZipfQueries(generator, dictionary, config.query_count, config.max_query_words, config.zipf_exponent, config.minus_word_probability);
+        } else {
+            std::ifstream input(config.query_log);
+            if (!input) {
+                throw std::invalid_argument("Can't open query log "s + config.query_log);
+            }
+            query_log = ReadQueryLog(input);
+            for (const auto& [_, query] : query_log) {
+                queries.push_back(query);
+            }
+        }
+        std::vector<int> match_ids;
+        for (int i = 0; i < config.match_document_count; ++i) {
+            match_ids.push_back(std::uniform_int_distribution(0, config.document_count - 1)(generator));
+        }
+
+        const auto no_setup = [] { return 0; };
+
+        SearchServerOptions unpooled_options;
+        unpooled_options.pooled_allocation = false;
+        runner.Run("AddDocument"s, documents.size(), no_setup, [&documents](int) {
+            Consume(BuildServer(documents)->GetDocumentCount());
+        });
+        runner.Run("AddDocument/unpooled"s, documents.size(), no_setup, [&documents, unpooled_options](int) {
+            Consume(BuildServer(documents, unpooled_options)->GetDocumentCount());
+        });
+        //уничтожение индекса, сервер строится вне замера
+        runner.Run("DestroyIndex"s, documents.size(), [&documents] {
+            return BuildServer(documents);
+        }, [](auto& server) {
+            server.reset();
+        });
+        runner.Run("DestroyIndex/unpooled"s, documents.size(), [&documents, unpooled_options] {
+            return BuildServer(documents, unpooled_options);
+        }, [](auto& server) {
+            server.reset();
+        });
+
+        const auto search_server = BuildServer(documents);
+        //в записанном журнале бывают некорректные запросы: замеряются только корректные
+        const auto is_invalid = [&search_server](const std::string& query) {
+            return search_server->ValidateQuery(query) != QueryParseStatus::OK;
+        };
+        const size_t invalid_count = std::count_if(queries.begin(), queries.end(), is_invalid);
+        if (invalid_count > 0) {
+            std::cerr << "Skipped "s << invalid_count << " invalid queries"s << std::endl;
+            queries.erase(std::remove_if(queries.begin(), queries.end(), is_invalid), queries.end());
+            query_log.erase(std::remove_if(query_log.begin(), query_log.end(), [&is_invalid](const LoggedQuery& logged) {
+                return is_invalid(logged.query);
+            }), query_log.end());
+        }
+        const size_t match_queries = std::min<size_t>(queries.size(), 100);
+        SearchServerOptions float_options;
+        float_options.float_postings = true;
+        const auto float_server = BuildServer(documents, float_options);
+
+        runner.Run("FindTopDocuments/seq"s, queries.size(), no_setup, [&](int) {
+            RunFindTopDocuments(*search_server, queries, std::execution::seq);
+        });
+        runner.Run("FindTopDocuments/par"s, queries.size(), no_setup, [&](int) {
+            RunFindTopDocuments(*search_server, queries, std::execution::par);
+        });
+        runner.Run("FindTopDocuments/max_score"s, queries.size(), no_setup, [&](int) {
+            RunFindTopDocuments(*search_server, queries, retrieval::max_score);
+        });
+        runner.Run("FindTopDocuments/impact_ordered"s, queries.size(), no_setup, [&](int) {
+            RunFindTopDocuments(*search_server, queries, retrieval::impact_ordered);
+        });
+        runner.Run("FindTopDocuments/float_accumulate"s, queries.size(), no_setup, [&](int) {
+            RunFindTopDocuments(*float_server, queries, retrieval::float_accumulate);
+        });
+        runner.Run("FindTopDocuments/bm25"s, queries.size(), no_setup, [&](int) {
+            for (const auto& query : queries) {
+                Consume(search_server->FindTopDocuments(std::execution::seq, query, predicates::AnyDocument{}, scoring::Bm25{}).size());
+            }
+        });
+        runner.Run("FindTopDocuments/rating_between"s, queries.size(), no_setup, [&](int) {
+            for (const auto& query : queries) {
+                Consume(search_server->FindTopDocuments(std::execution::seq, query, predicates::RatingBetween{ 2, 5 }).size());
+            }
+        });
+        runner.Run("FindTopDocuments/lambda_predicate"s, queries.size(), no_setup, [&](int) {
+            for (const auto& query : queries) {
+                Consume(search_server->FindTopDocuments(query, [](int document_id, DocumentStatus, int) {
+                    return document_id % 2 == 0;
+                }).size());
+            }
+        });
+
+        //документы добавляются из shard_count потоков: изменения разных шардов не ждут друг друга
+        const auto build_sharded = [&documents, &config] {
+            auto sharded_server = std::make_unique<ShardedSearchServer>(""sv, config.shard_count);
+            std::vector<int> writers(config.shard_count);
+            std::iota(writers.begin(), writers.end(), 0);
+            std::for_each(std::execution::par, writers.begin(), writers.end(), [&](int writer) {
+                for (int id = writer; id < static_cast<int>(documents.size()); id += config.shard_count) {
+                    sharded_server->AddDocument(id, documents[id], DocumentStatus::ACTUAL, { id % 10, 5 });
+                }
+            });
+            return sharded_server;
+        };
+        runner.Run("AddDocument/sharded"s, documents.size(), no_setup, [&build_sharded](int) {
+            Consume(build_sharded()->GetDocumentCount());
+        });
+        const auto sharded_server = build_sharded();
+        runner.Run("FindTopDocuments/sharded"s, queries.size(), no_setup, [&](int) {
+            for (const auto& query : queries) {
+                Consume(sharded_server->FindTopDocuments(query).size());
+            }
+        });
+
+        runner.Run("MatchDocument/seq"s, match_queries * match_ids.size(), no_setup, [&](int) {
+            for (size_t i = 0; i < match_queries; ++i) {
+                for (const int id : match_ids) {
+                    Consume(std::get<0>(search_server->MatchDocument(std::execution::seq, queries[i], id)).size());
+                }
+            }
+        });
+        runner.Run("MatchDocument/par"s, match_queries * match_ids.size(), no_setup, [&](int) {
+            for (size_t i = 0; i < match_queries; ++i) {
+                for (const int id : match_ids) {
+                    Consume(std::get<0>(search_server->MatchDocument(std::execution::par, queries[i], id)).size());
+                }
+            }
+        });
+        runner.Run("MatchDocuments/batch"s, match_queries * match_ids.size(), no_setup, [&](int) {
+            for (size_t i = 0; i < match_queries; ++i) {
+                Consume(search_server->MatchDocuments(queries[i], match_ids).size());
+            }
+        });
+
+        runner.Run("ProcessQueries"s, queries.size(), no_setup, [&](int) {
+            Consume(ProcessQueries(*search_server, queries).size());
+        });
+        runner.Run("ProcessQueriesJoined"s, queries.size(), no_setup, [&](int) {
+            Consume(ProcessQueriesJoined(*search_server, queries).size());
+        });
+        if (!query_log.empty()) {
+            //длительность - от первого запроса до последнего ответа: при перегрузке больше длительности журнала
+            runner.Run("ReplayQueryLog"s, query_log.size(), no_setup, [&](int) {
+                AsyncSearchServer async_server(*search_server, query_log.size());
+                std::vector<std::future<std::vector<Document>>> results;
+                results.reserve(query_log.size());
+                const ReplayStats stats = ReplayQueryLog(query_log, [&async_server, &results](const std::string& query) {
+                    if (auto result = async_server.SubmitFind(query)) {
+                        results.push_back(std::move(*result));
+                    }
+                }, config.replay_speedup);
+                for (auto& result : results) {
+                    Consume(result.get().size());
+                }
+                std::cerr << "ReplayQueryLog: max lag "s << std::chrono::duration<double, std::milli>(stats.max_lag).count()
+                    << " ms, rejected "s << async_server.GetRejectedCount() << std::endl;
+            });
+        }
+
+        //удаляется каждый второй документ, сервер строится заново вне замера
+        const auto build_full = [&documents] {
+            return BuildServer(documents);
+        };
+        runner.Run("RemoveDocument/seq"s, documents.size() / 2, build_full, [&documents](auto& server) {
+            for (int id = 0; id < static_cast<int>(documents.size()); id += 2) {
+                server->RemoveDocument(std::execution::seq, id);
+            }
+            Consume(server->GetDocumentCount());
+        });
+        runner.Run("RemoveDocument/par"s, documents.size() / 2, build_full, [&documents](auto& server) {
+            for (int id = 0; id < static_cast<int>(documents.size()); id += 2) {
+                server->RemoveDocument(std::execution::par, id);
+            }
+            Consume(server->GetDocumentCount());
+        });
+
+        //каждый документ повторён дважды
+        std::vector<std::string> duplicated_documents;
+        const int duplicate_source_count = std::min<int>(config.duplicate_document_count / 2, documents.size());
+        for (int i = 0; i < duplicate_source_count; ++i) {
+            duplicated_documents.push_back(documents[i]);
+            duplicated_documents.push_back(documents[i]);
+        }
+        runner.Run("RemoveDuplicates"s, duplicated_documents.size(), [&duplicated_documents] {
+            return BuildServer(duplicated_documents);
+        }, [](auto& server) {
+            //RemoveDuplicates сообщает о каждом удалённом документе в cout - это не должно попасть в JSON
+            std::ostringstream discarded;
+            auto* const cout_buffer = std::cout.rdbuf(discarded.rdbuf());
+            RemoveDuplicates(*server);
+            std::cout.rdbuf(cout_buffer);
+            Consume(server->GetDocumentCount());
+        });
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const BenchmarkConfig config = ParseArguments(argc, argv);
+        BenchmarkRunner runner(config);
+        RunBenchmarks(config, runner);
+        if (config.output.empty()) {
+            runner.WriteJson(std::cout);
+        } else {
+            std::ofstream out(config.output);
+            runner.WriteJson(out);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "benchmark: "s << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
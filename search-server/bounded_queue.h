@@ -0,0 +1,66 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// Ограниченная очередь для нескольких производителей и потребителей.
+// Производитель не ждёт: при заполненной очереди TryPush отказывает (контроль допуска),
+// потребители ждут элементов в Pop до закрытия очереди.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+        : capacity_(capacity) {
+    }
+
+    // false - очередь заполнена или закрыта, value при этом не перемещается
+    bool TryPush(T& value) {
+        {
+            std::lock_guard guard(mutex_);
+            if (closed_ || items_.size() >= capacity_) {
+                return false;
+            }
+            items_.push_back(std::move(value));
+        }
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // false - очередь закрыта и пуста
+    bool Pop(T& value) {
+        std::unique_lock lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) {
+            return false;
+        }
+        value = std::move(items_.front());
+        items_.pop_front();
+        return true;
+    }
+
+    // новые элементы не принимаются, оставшиеся ещё можно забрать
+    void Close() {
+        {
+            std::lock_guard guard(mutex_);
+            closed_ = true;
+        }
+        not_empty_.notify_all();
+    }
+
+    size_t Size() const {
+        std::lock_guard guard(mutex_);
+        return items_.size();
+    }
+
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::deque<T> items_;
+    const size_t capacity_;
+    bool closed_ = false;
+};
@@ -0,0 +1,35 @@
+#include "corpus_statistics.h"
+
+using namespace std;
+
+namespace {
+    void MergeDocumentFreqs(map<string, size_t, less<>>& to, const map<string, size_t, less<>>& from) {
+        for (const auto& [term, document_freq] : from) {
+            to[term] += document_freq;
+        }
+    }
+
+    size_t FindDocumentFreq(const map<string, size_t, less<>>& document_freqs, string_view term, size_t document_freq) {
+        const auto it = document_freqs.find(term);
+        return it == document_freqs.end() ? document_freq : it->second;
+    }
+}
+
+void CorpusStatistics::Merge(const CorpusStatistics& other) {
+    document_count += other.document_count;
+    total_length += other.total_length;
+    MergeDocumentFreqs(word_document_freqs, other.word_document_freqs);
+    MergeDocumentFreqs(prefix_document_freqs, other.prefix_document_freqs);
+}
+
+double CorpusStatistics::AverageLength() const {
+    return document_count == 0 ? 0.0 : static_cast<double>(total_length) / document_count;
+}
+
+size_t CorpusStatistics::GetWordDocumentFreq(string_view word, size_t document_freq) const {
+    return FindDocumentFreq(word_document_freqs, word, document_freq);
+}
+
+size_t CorpusStatistics::GetPrefixDocumentFreq(string_view prefix, size_t document_freq) const {
+    return FindDocumentFreq(prefix_document_freqs, prefix, document_freq);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+// Статистика корпуса, от которой зависит ранжирование: число документов, их суммарная длина
+// и число документов со словами и префиксами запроса. Шарды собирают её для своих документов,
+// сумма по шардам - статистика всего корпуса: документы шардов не пересекаются.
+struct CorpusStatistics {
+    size_t document_count = 0;
+    uint64_t total_length = 0; //слов без стоп-слов во всех документах
+    std::map<std::string, size_t, std::less<>> word_document_freqs;
+    //префикс cat* - число документов хотя бы с одним словом, которое его раскрывает
+    std::map<std::string, size_t, std::less<>> prefix_document_freqs;
+
+    void Merge(const CorpusStatistics& other);
+
+    double AverageLength() const;
+    // document_freq, если слова нет в статистике
+    size_t GetWordDocumentFreq(std::string_view word, size_t document_freq) const;
+    size_t GetPrefixDocumentFreq(std::string_view prefix, size_t document_freq) const;
+};
@@ -0,0 +1,38 @@
+#include "counting_memory_resource.h"
+
+using namespace std;
+
+CountingMemoryResource::CountingMemoryResource(pmr::memory_resource* upstream)
+    : upstream_(upstream) {
+}
+
+size_t CountingMemoryResource::GetBytesInUse() const {
+    return bytes_in_use_.load(memory_order_relaxed);
+}
+
+size_t CountingMemoryResource::GetPeakBytes() const {
+    return peak_bytes_.load(memory_order_relaxed);
+}
+
+size_t CountingMemoryResource::GetAllocationCount() const {
+    return allocation_count_.load(memory_order_relaxed);
+}
+
+void* CountingMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    void* const pointer = upstream_->allocate(bytes, alignment);
+    const size_t in_use = bytes_in_use_.fetch_add(bytes, memory_order_relaxed) + bytes;
+    allocation_count_.fetch_add(1, memory_order_relaxed);
+    size_t peak = peak_bytes_.load(memory_order_relaxed);
+    while (peak < in_use && !peak_bytes_.compare_exchange_weak(peak, in_use, memory_order_relaxed)) {
+    }
+    return pointer;
+}
+
+void CountingMemoryResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    upstream_->deallocate(pointer, bytes, alignment);
+    bytes_in_use_.fetch_sub(bytes, memory_order_relaxed);
+}
+
+bool CountingMemoryResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
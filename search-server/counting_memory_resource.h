@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+// Ресурс памяти, считающий выделенные через него байты; сама память берётся у upstream.
+// Контейнеры индекса получают его через std::pmr-аллокаторы, поэтому объём части индекса
+// известен в любой момент без обхода контейнеров. Счётчики атомарные: RemoveDocument(par)
+// освобождает память из нескольких потоков.
+class CountingMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit CountingMemoryResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    CountingMemoryResource(const CountingMemoryResource&) = delete;
+    CountingMemoryResource& operator=(const CountingMemoryResource&) = delete;
+
+    // байты, выделенные и ещё не освобождённые
+    size_t GetBytesInUse() const;
+    // наибольшее значение GetBytesInUse за время жизни
+    size_t GetPeakBytes() const;
+    // число выделений за время жизни
+    size_t GetAllocationCount() const;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> bytes_in_use_{ 0 };
+    std::atomic<size_t> peak_bytes_{ 0 };
+    std::atomic<size_t> allocation_count_{ 0 };
+};
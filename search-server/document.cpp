@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include "document.h"
 
 using namespace std::literals;
@@ -17,7 +19,7 @@ std::ostream& operator<<(std::ostream& out, const Document& rhs) {
 }
 
 bool operator==(const Document & lhs, const Document & rhs){
-    return lhs.id == rhs.id && (abs(lhs.relevance - rhs.relevance) < MAX_RELEVANCE_INACCURACY) && lhs.rating == rhs.rating;
+    return lhs.id == rhs.id && (std::abs(lhs.relevance - rhs.relevance) < MAX_RELEVANCE_INACCURACY) && lhs.rating == rhs.rating;
 }
 
 bool operator!=(const Document& lhs, const Document& rhs) {
@@ -26,7 +28,7 @@ bool operator!=(const Document& lhs, const Document& rhs) {
 
 bool operator<(const Document& lhs, const Document& rhs) {
     //      
-    if (abs(lhs.relevance - rhs.relevance) < MAX_RELEVANCE_INACCURACY) {
+    if (std::abs(lhs.relevance - rhs.relevance) < MAX_RELEVANCE_INACCURACY) {
         return lhs.rating < rhs.rating;
     }
     return lhs.relevance < rhs.relevance;
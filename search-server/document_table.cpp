@@ -0,0 +1,111 @@
+#include "document_table.h"
+
+#include <algorithm>
+
+using namespace std;
+
+DocumentTable::DocumentTable(pmr::memory_resource* resource)
+    : id_to_ordinal_(resource)
+    , dense_ordinals_(resource)
+    , ids_(resource)
+    , ratings_(resource)
+    , statuses_(resource)
+    , lengths_(resource)
+    , free_ordinals_(resource) {
+}
+
+DocumentTable::Ordinal DocumentTable::Add(int document_id, int rating, DocumentStatus status, uint32_t length) {
+    Ordinal ordinal;
+    if (!free_ordinals_.empty()) {
+        ordinal = free_ordinals_.back();
+        free_ordinals_.pop_back();
+        ids_[ordinal] = document_id;
+        ratings_[ordinal] = rating;
+        statuses_[ordinal] = status;
+        lengths_[ordinal] = length;
+    }
+    else {
+        ordinal = static_cast<Ordinal>(ids_.size());
+        ids_.push_back(document_id);
+        ratings_.push_back(rating);
+        statuses_.push_back(status);
+        lengths_.push_back(length);
+    }
+    id_to_ordinal_.emplace(document_id, ordinal);
+    if (document_id >= 0) {
+        GrowDenseOrdinals(static_cast<size_t>(document_id));
+        if (static_cast<size_t>(document_id) < dense_ordinals_.size()) {
+            dense_ordinals_[document_id] = ordinal;
+        }
+    }
+    total_length_ += length;
+    return ordinal;
+}
+
+void DocumentTable::Remove(int document_id) {
+    const auto it = id_to_ordinal_.find(document_id);
+    if (it == id_to_ordinal_.end()) {
+        return;
+    }
+    const Ordinal ordinal = it->second;
+    id_to_ordinal_.erase(it);
+    if (document_id >= 0 && static_cast<size_t>(document_id) < dense_ordinals_.size()) {
+        dense_ordinals_[document_id] = NPOS;
+    }
+    total_length_ -= lengths_[ordinal];
+    //последний номер просто отрезаем, остальные отдаём на переиспользование
+    if (ordinal + 1 == ids_.size()) {
+        ids_.pop_back();
+        ratings_.pop_back();
+        statuses_.pop_back();
+        lengths_.pop_back();
+    }
+    else {
+        statuses_[ordinal] = DocumentStatus::REMOVED;
+        free_ordinals_.push_back(ordinal);
+    }
+}
+
+bool DocumentTable::Contains(int document_id) const {
+    return Find(document_id) != NPOS;
+}
+
+DocumentTable::Ordinal DocumentTable::Find(int document_id) const {
+    if (document_id >= 0 && static_cast<size_t>(document_id) < dense_ordinals_.size()) {
+        return dense_ordinals_[document_id];
+    }
+    const auto it = id_to_ordinal_.find(document_id);
+    return it == id_to_ordinal_.end() ? NPOS : it->second;
+}
+
+size_t DocumentTable::Size() const {
+    return id_to_ordinal_.size();
+}
+
+size_t DocumentTable::Capacity() const {
+    return ids_.size();
+}
+
+void DocumentTable::GrowDenseOrdinals(size_t document_id) {
+    const size_t old_size = dense_ordinals_.size();
+    const size_t limit = DENSE_ID_FACTOR * id_to_ordinal_.size() + DENSE_ID_MIN;
+    if (document_id < old_size || document_id >= limit) {
+        return;
+    }
+    //с запасом вдвое, чтобы последовательные id не перестраивали массив на каждом документе
+    const size_t new_size = min(limit, max(document_id + 1, 2 * old_size));
+    dense_ordinals_.resize(new_size, NPOS);
+    //документы с id из новой части массива до сих пор были только в map
+    for (auto it = id_to_ordinal_.lower_bound(static_cast<int>(old_size));
+         it != id_to_ordinal_.end() && static_cast<size_t>(it->first) < new_size; ++it) {
+        dense_ordinals_[it->first] = it->second;
+    }
+}
+
+DocumentTable::IdIterator DocumentTable::begin() const {
+    return IdIterator(id_to_ordinal_.begin());
+}
+
+DocumentTable::IdIterator DocumentTable::end() const {
+    return IdIterator(id_to_ordinal_.end());
+}
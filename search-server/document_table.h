@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory_resource>
+#include <vector>
+
+#include "document.h"
+
+// Таблица метаданных документов в виде структуры массивов: рейтинг, статус и длина документа лежат
+// в непрерывных массивах по плотному порядковому номеру (ordinal). id переводится в ordinal плотным массивом,
+// а id, слишком большие для него, - через map.
+// Номера стабильны на всё время жизни документа, освободившиеся номера переиспользуются.
+class DocumentTable {
+public:
+    using Ordinal = uint32_t;
+    static constexpr Ordinal NPOS = UINT32_MAX;
+
+    // обход id документов по возрастанию
+    class IdIterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        IdIterator() = default;
+        explicit IdIterator(std::pmr::map<int, Ordinal>::const_iterator it) : it_(it) {}
+
+        reference operator*() const { return it_->first; }
+        pointer operator->() const { return &it_->first; }
+        IdIterator& operator++() { ++it_; return *this; }
+        IdIterator operator++(int) { IdIterator copy = *this; ++it_; return copy; }
+        IdIterator& operator--() { --it_; return *this; }
+        IdIterator operator--(int) { IdIterator copy = *this; --it_; return copy; }
+        friend bool operator==(const IdIterator& lhs, const IdIterator& rhs) { return lhs.it_ == rhs.it_; }
+        friend bool operator!=(const IdIterator& lhs, const IdIterator& rhs) { return lhs.it_ != rhs.it_; }
+
+    private:
+        std::pmr::map<int, Ordinal>::const_iterator it_;
+    };
+
+    // память массивов и map берётся из resource
+    explicit DocumentTable(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // length - число слов документа без стоп-слов
+    Ordinal Add(int document_id, int rating, DocumentStatus status, uint32_t length);
+    void Remove(int document_id);
+
+    bool Contains(int document_id) const;
+    // NPOS, если документа нет
+    Ordinal Find(int document_id) const;
+
+    int GetId(Ordinal ordinal) const {
+        return ids_[ordinal];
+    }
+    int GetRating(Ordinal ordinal) const {
+        return ratings_[ordinal];
+    }
+    DocumentStatus GetStatus(Ordinal ordinal) const {
+        return statuses_[ordinal];
+    }
+    uint32_t GetLength(Ordinal ordinal) const {
+        return lengths_[ordinal];
+    }
+    // средняя длина документа, поддерживается при добавлении и удалении
+    double AverageLength() const {
+        return id_to_ordinal_.empty() ? 0.0 : static_cast<double>(total_length_) / id_to_ordinal_.size();
+    }
+    uint64_t TotalLength() const {
+        return total_length_;
+    }
+
+    size_t Size() const;
+    // размер массивов, включая освободившиеся номера
+    size_t Capacity() const;
+
+    IdIterator begin() const;
+    IdIterator end() const;
+
+private:
+    // плотный массив номеров растёт, пока id не больше DENSE_ID_FACTOR * Size() + DENSE_ID_MIN
+    static constexpr size_t DENSE_ID_FACTOR = 4;
+    static constexpr size_t DENSE_ID_MIN = 1024;
+
+    void GrowDenseOrdinals(size_t document_id);
+
+    std::pmr::map<int, Ordinal> id_to_ordinal_;
+    // номер по id для id меньше размера массива (NPOS - документа нет): Find без обхода дерева
+    // для плотных id; редкие большие id есть только в id_to_ordinal_
+    std::pmr::vector<Ordinal> dense_ordinals_;
+    std::pmr::vector<int> ids_;
+    std::pmr::vector<int> ratings_;
+    std::pmr::vector<DocumentStatus> statuses_;
+    std::pmr::vector<uint32_t> lengths_;
+    uint64_t total_length_ = 0;
+    std::pmr::vector<Ordinal> free_ordinals_;
+};
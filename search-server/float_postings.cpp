@@ -0,0 +1,171 @@
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "float_postings.h"
+
+using namespace std;
+
+namespace {
+    int PopCount(uint64_t word) {
+#if defined(_MSC_VER)
+        return static_cast<int>(__popcnt64(word));
+#else
+        return __builtin_popcountll(word);
+#endif
+    }
+}
+
+void FloatAccumulator::Reset(size_t ordinal_count) {
+    for (const uint32_t block : touched_blocks_) {
+        fill_n(scores_.begin() + static_cast<size_t>(block) * FloatPostingList::BLOCK_SIZE, FloatPostingList::BLOCK_SIZE, 0.0f);
+        found_[block] = 0;
+    }
+    touched_blocks_.clear();
+    const size_t size = (ordinal_count + FloatPostingList::BLOCK_SIZE - 1) / FloatPostingList::BLOCK_SIZE * FloatPostingList::BLOCK_SIZE;
+    if (size > scores_.size()) {
+        scores_.resize(size);
+        found_.resize(size / FloatPostingList::BLOCK_SIZE);
+    }
+}
+
+FloatPostingList::FloatPostingList(const allocator_type& allocator)
+    : blocks_(allocator) {
+}
+
+FloatPostingList::FloatPostingList(const FloatPostingList& other, const allocator_type& allocator)
+    : blocks_(other.blocks_, allocator)
+    , size_(other.size_) {
+}
+
+FloatPostingList::FloatPostingList(FloatPostingList&& other, const allocator_type& allocator)
+    : blocks_(std::move(other.blocks_), allocator)
+    , size_(other.size_) {
+}
+
+void FloatPostingList::Set(uint32_t ordinal, float term_freq) {
+    const uint32_t index = ordinal / BLOCK_SIZE;
+    const uint8_t offset = static_cast<uint8_t>(ordinal % BLOCK_SIZE);
+    const uint64_t bit = uint64_t{ 1 } << offset;
+
+    auto it = lower_bound(blocks_.begin(), blocks_.end(), index,
+        [](const Block& block, uint32_t value) { return block.index < value; });
+    if (it == blocks_.end() || it->index != index) {
+        Block block(blocks_.get_allocator());
+        block.index = index;
+        it = blocks_.insert(it, move(block));
+    }
+    Block& block = *it;
+    if ((block.mask & bit) == 0) {
+        block.mask |= bit;
+        ++size_;
+    }
+
+    if (block.dense) {
+        block.term_freqs[offset] = term_freq;
+        return;
+    }
+    const auto it_offset = lower_bound(block.offsets.begin(), block.offsets.end(), offset);
+    const size_t position = distance(block.offsets.begin(), it_offset);
+    if (it_offset != block.offsets.end() && *it_offset == offset) {
+        block.term_freqs[position] = term_freq;
+        return;
+    }
+    block.offsets.insert(it_offset, offset);
+    block.term_freqs.insert(block.term_freqs.begin() + position, term_freq);
+
+    if (block.offsets.size() > DENSE_LIMIT) {
+        pmr::vector<float> term_freqs(BLOCK_SIZE, 0.0f, block.term_freqs.get_allocator());
+        for (size_t i = 0; i < block.offsets.size(); ++i) {
+            term_freqs[block.offsets[i]] = block.term_freqs[i];
+        }
+        block.term_freqs = move(term_freqs);
+        block.offsets.clear();
+        block.offsets.shrink_to_fit();
+        block.dense = true;
+    }
+}
+
+void FloatPostingList::Erase(uint32_t ordinal) {
+    const uint32_t index = ordinal / BLOCK_SIZE;
+    const uint8_t offset = static_cast<uint8_t>(ordinal % BLOCK_SIZE);
+    const uint64_t bit = uint64_t{ 1 } << offset;
+
+    const auto it = lower_bound(blocks_.begin(), blocks_.end(), index,
+        [](const Block& block, uint32_t value) { return block.index < value; });
+    if (it == blocks_.end() || it->index != index || (it->mask & bit) == 0) {
+        return;
+    }
+    Block& block = *it;
+    block.mask &= ~bit;
+    --size_;
+    if (block.mask == 0) {
+        blocks_.erase(it);
+        return;
+    }
+
+    if (!block.dense) {
+        const auto it_offset = lower_bound(block.offsets.begin(), block.offsets.end(), offset);
+        block.term_freqs.erase(block.term_freqs.begin() + distance(block.offsets.begin(), it_offset));
+        block.offsets.erase(it_offset);
+        return;
+    }
+    block.term_freqs[offset] = 0.0f;
+    if (static_cast<size_t>(PopCount(block.mask)) <= DENSE_LIMIT / 2) {
+        pmr::vector<uint8_t> offsets(block.offsets.get_allocator());
+        pmr::vector<float> term_freqs(block.term_freqs.get_allocator());
+        for (uint8_t i = 0; i < BLOCK_SIZE; ++i) {
+            if ((block.mask >> i) & 1) {
+                offsets.push_back(i);
+                term_freqs.push_back(block.term_freqs[i]);
+            }
+        }
+        block.offsets = move(offsets);
+        block.term_freqs = move(term_freqs);
+        block.dense = false;
+    }
+}
+
+size_t FloatPostingList::Size() const {
+    return size_;
+}
+
+void FloatPostingList::AccumulateTo(float weight, FloatAccumulator& accumulator) const {
+    for (const Block& block : blocks_) {
+        float* scores = accumulator.scores_.data() + static_cast<size_t>(block.index) * BLOCK_SIZE;
+        if (block.dense) {
+            AddScaled(block.term_freqs.data(), weight, scores, BLOCK_SIZE);
+        }
+        else {
+            for (size_t i = 0; i < block.offsets.size(); ++i) {
+                scores[block.offsets[i]] += block.term_freqs[i] * weight;
+            }
+        }
+        if (accumulator.found_[block.index] == 0) {
+            accumulator.touched_blocks_.push_back(block.index);
+        }
+        accumulator.found_[block.index] |= block.mask;
+    }
+}
+
+void FloatPostingList::ExcludeFrom(FloatAccumulator& accumulator) const {
+    for (const Block& block : blocks_) {
+        if (block.index < accumulator.found_.size()) {
+            accumulator.found_[block.index] &= ~block.mask;
+        }
+    }
+}
+
+void AddScaled(const float* src, float weight, float* dst, size_t count) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 weights = _mm256_set1_ps(weight);
+    for (; i + 8 <= count; i += 8) {
+        const __m256 products = _mm256_mul_ps(_mm256_loadu_ps(src + i), weights);
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), products));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] += src[i] * weight;
+    }
+}
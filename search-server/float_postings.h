@@ -0,0 +1,124 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Плотный массив релевантностей float по порядковым номерам документов (DocumentTable::Ordinal)
+// и битовая маска документов, в которых нашлось хотя бы одно плюс-слово.
+// Переиспользуется от запроса к запросу: Reset обнуляет только блоки, затронутые предыдущим запросом,
+// поэтому запрос стоит пропорционально числу обработанных блоков, а не числу документов индекса.
+class FloatAccumulator {
+public:
+    // готовит массив к запросу по ordinal_count документам; массив только растёт
+    void Reset(size_t ordinal_count);
+
+    // обход найденных документов по возрастанию номера: function(ordinal, relevance)
+    template <typename Function>
+    void ForEachFound(Function function) {
+        std::sort(touched_blocks_.begin(), touched_blocks_.end());
+        touched_blocks_.erase(std::unique(touched_blocks_.begin(), touched_blocks_.end()), touched_blocks_.end());
+        for (const uint32_t block : touched_blocks_) {
+            for (uint64_t mask = found_[block]; mask != 0; mask &= mask - 1) {
+                const uint32_t ordinal = static_cast<uint32_t>(block * 64 + CountTrailingZeros(mask));
+                function(ordinal, scores_[ordinal]);
+            }
+        }
+    }
+
+private:
+    friend class FloatPostingList;
+
+    static int CountTrailingZeros(uint64_t word) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    std::vector<float> scores_;
+    std::vector<uint64_t> found_;
+    // блоки, в которые писал запрос; повторы возможны, если блок исключён минус-словом и затронут снова
+    std::vector<uint32_t> touched_blocks_;
+};
+
+// Список вхождений слова с tf в float32, упорядоченный по порядковым номерам документов.
+// Номера разбиты на блоки по 64: редкий блок хранит смещения и tf подряд, частый - все 64 значения tf
+// (0 - документа нет) и прибавляется к массиву релевантностей векторными инструкциями без gather/scatter.
+// Маска блока отмечает присутствующие документы: вклад, равный нулю (idf = 0), тоже делает документ найденным.
+class FloatPostingList {
+public:
+    static constexpr uint32_t BLOCK_SIZE = 64;
+
+    // в map<string_view, FloatPostingList> с pmr-аллокатором блоки берут память у ресурса map
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    FloatPostingList() = default;
+    explicit FloatPostingList(const allocator_type& allocator);
+    FloatPostingList(const FloatPostingList& other, const allocator_type& allocator);
+    FloatPostingList(FloatPostingList&& other, const allocator_type& allocator);
+    FloatPostingList(const FloatPostingList&) = default;
+    FloatPostingList(FloatPostingList&&) = default;
+    FloatPostingList& operator=(const FloatPostingList&) = default;
+    FloatPostingList& operator=(FloatPostingList&&) = default;
+
+    void Set(uint32_t ordinal, float term_freq);
+    void Erase(uint32_t ordinal);
+    size_t Size() const;
+
+    // relevance[ordinal] += term_freq * weight, документы списка отмечаются найденными
+    void AccumulateTo(float weight, FloatAccumulator& accumulator) const;
+    // документы списка перестают быть найденными (минус-слово)
+    void ExcludeFrom(FloatAccumulator& accumulator) const;
+
+private:
+    // редкий блок становится частым, когда в нём больше DENSE_LIMIT документов, и обратно - при вдвое меньшем числе
+    static constexpr size_t DENSE_LIMIT = 16;
+
+    struct Block {
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+        explicit Block(const allocator_type& allocator)
+            : offsets(allocator)
+            , term_freqs(allocator) {
+        }
+        Block(const Block& other, const allocator_type& allocator)
+            : index(other.index)
+            , dense(other.dense)
+            , mask(other.mask)
+            , offsets(other.offsets, allocator)
+            , term_freqs(other.term_freqs, allocator) {
+        }
+        Block(Block&& other, const allocator_type& allocator)
+            : index(other.index)
+            , dense(other.dense)
+            , mask(other.mask)
+            , offsets(std::move(other.offsets), allocator)
+            , term_freqs(std::move(other.term_freqs), allocator) {
+        }
+        Block(const Block&) = default;
+        Block(Block&&) = default;
+        Block& operator=(const Block&) = default;
+        Block& operator=(Block&&) = default;
+
+        uint32_t index = 0; // ordinal / BLOCK_SIZE
+        bool dense = false;
+        uint64_t mask = 0;
+        std::pmr::vector<uint8_t> offsets; // редкий блок: ordinal % BLOCK_SIZE по возрастанию
+        std::pmr::vector<float> term_freqs; // редкий блок - параллельно offsets, частый - BLOCK_SIZE значений
+    };
+
+    std::pmr::vector<Block> blocks_; // по возрастанию index
+    size_t size_ = 0;
+};
+
+// dst[i] += src[i] * weight для i < count; с AVX2 - по 8 значений за инструкцию
+void AddScaled(const float* src, float weight, float* dst, size_t count);
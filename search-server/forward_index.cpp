@@ -0,0 +1,45 @@
+#include "forward_index.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    bool IsWordLess(ForwardIndex::Word lhs, ForwardIndex::Word rhs) {
+        return string_view(*lhs) < string_view(*rhs);
+    }
+}
+
+ForwardIndex::ForwardIndex(pmr::memory_resource* resource)
+    : documents_(resource) {
+}
+
+void ForwardIndex::Set(DocumentTable::Ordinal ordinal, vector<Word> words) {
+    if (ordinal >= documents_.size()) {
+        documents_.resize(ordinal + 1);
+    }
+    sort(words.begin(), words.end(), IsWordLess);
+    //assign по точному размеру: массив документа не растёт после добавления
+    documents_[ordinal].assign(words.begin(), words.end());
+}
+
+void ForwardIndex::Clear(DocumentTable::Ordinal ordinal) {
+    documents_[ordinal].clear();
+    documents_[ordinal].shrink_to_fit();
+}
+
+const ForwardIndex::Words& ForwardIndex::Get(DocumentTable::Ordinal ordinal) const {
+    return documents_[ordinal];
+}
+
+ForwardIndex::Word ForwardIndex::Find(DocumentTable::Ordinal ordinal, string_view word) const {
+    const auto it = LowerBound(ordinal, word);
+    return it != documents_[ordinal].end() && string_view(**it) == word ? *it : nullptr;
+}
+
+ForwardIndex::Words::const_iterator ForwardIndex::LowerBound(DocumentTable::Ordinal ordinal, string_view word) const {
+    const Words& words = documents_[ordinal];
+    return lower_bound(words.begin(), words.end(), word, [](Word lhs, string_view rhs) {
+        return string_view(*lhs) < rhs;
+    });
+}
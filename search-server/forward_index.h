@@ -0,0 +1,34 @@
+#pragma once
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document_table.h"
+
+// Прямой индекс: слова каждого документа в виде отсортированного по алфавиту массива указателей
+// на строки словаря, по порядковому номеру документа из DocumentTable. Слово занимает 8 байт
+// вместо узла map со string_view и частотой: частоты есть в обратном индексе.
+class ForwardIndex {
+public:
+    // строки словаря не перемещаются, пока живёт индекс
+    using Word = const std::pmr::string*;
+    using Words = std::pmr::vector<Word>;
+
+    // память массивов берётся из resource
+    explicit ForwardIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // words - различные слова документа в любом порядке
+    void Set(DocumentTable::Ordinal ordinal, std::vector<Word> words);
+    void Clear(DocumentTable::Ordinal ordinal);
+
+    // слова документа по алфавиту
+    const Words& Get(DocumentTable::Ordinal ordinal) const;
+    // nullptr, если слова нет в документе
+    Word Find(DocumentTable::Ordinal ordinal, std::string_view word) const;
+    // первое слово документа, не меньшее word
+    Words::const_iterator LowerBound(DocumentTable::Ordinal ordinal, std::string_view word) const;
+
+private:
+    std::pmr::vector<Words> documents_;
+};
@@ -1,5 +1,14 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <istream>
+#include <ostream>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "log_duration.h"
 
@@ -39,11 +48,187 @@ string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int w
     return query;
 }
 
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+// номер слова словаря по закону Ципфа: слово с номером k выпадает с вероятностью, пропорциональной 1 / (k + 1)^exponent;
+// первые слова словаря становятся частыми, с длинными списками документов, как в реальных текстах
+class ZipfDistribution {
+public:
+    ZipfDistribution(int count, double exponent) {
+        cumulative_.reserve(count);
+        double sum = 0;
+        for (int rank = 1; rank <= count; ++rank) {
+            sum += 1.0 / pow(rank, exponent);
+            cumulative_.push_back(sum);
+        }
+    }
+
+    int operator()(mt19937& generator) const {
+        const double value = uniform_real_distribution<>(0, cumulative_.back())(generator);
+        const auto it = upper_bound(cumulative_.begin(), cumulative_.end(), value);
+        return static_cast<int>(min<ptrdiff_t>(it - cumulative_.begin(), cumulative_.size() - 1));
+    }
+
+private:
+    vector<double> cumulative_;
+};
+
+// длина документа в словах по логнормальному закону: большинство документов около median слов,
+// редкие длинные - в несколько раз больше; sigma = 0 - все документы длины median
+class DocumentLengthDistribution {
+public:
+    DocumentLengthDistribution(int median, double sigma, int max_length)
+        : length_(log(median), sigma)
+        , max_length_(max_length) {
+    }
+
+    int operator()(mt19937& generator) const {
+        return static_cast<int>(clamp(length_(generator), 1.0, static_cast<double>(max_length_)));
+    }
+
+private:
+    //operator() константный, а распределение меняет своё состояние
+    mutable lognormal_distribution<> length_;
+    int max_length_;
+};
+
+string GenerateDocument(mt19937& generator, const vector<string>& dictionary, const ZipfDistribution& word_distribution, int word_count) {
+    string document;
+    for (int i = 0; i < word_count; ++i) {
+        if (!document.empty()) {
+            document.push_back(' ');
+        }
+        document += dictionary[word_distribution(generator)];
+    }
+    return document;
+}
+
+// exponent = 0 - слова равновероятны, около 1 - распределение естественного языка
+vector<string> GenerateDocuments(mt19937& generator, const vector<string>& dictionary, int document_count, int max_word_count, double exponent) {
+    const ZipfDistribution word_distribution(dictionary.size(), exponent);
+    vector<string> documents;
+    documents.reserve(document_count);
+    for (int i = 0; i < document_count; ++i) {
+        documents.push_back(GenerateDocument(generator, dictionary, word_distribution, uniform_int_distribution(1, max_word_count)(generator)));
+    }
+    return documents;
+}
+
+vector<string> GenerateDocuments(mt19937& generator, const vector<string>& dictionary, int document_count, const DocumentLengthDistribution& length_distribution, double exponent) {
+    const ZipfDistribution word_distribution(dictionary.size(), exponent);
+    vector<string> documents;
+    documents.reserve(document_count);
+    for (int i = 0; i < document_count; ++i) {
+        documents.push_back(GenerateDocument(generator, dictionary, word_distribution, length_distribution(generator)));
+    }
+    return documents;
+}
+
+// слова запроса - с тем же распределением Ципфа, что и в документах: частые слова запрашиваются чаще
+string GenerateZipfQuery(mt19937& generator, const vector<string>& dictionary, const ZipfDistribution& word_distribution, int word_count, double minus_prob = 0) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[word_distribution(generator)];
+    }
+    return query;
+}
+
+// от 1 до max_word_count слов в запросе, каждое с вероятностью minus_prob - минус-слово
+vector<string> GenerateZipfQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count, double exponent, double minus_prob = 0) {
+    const ZipfDistribution word_distribution(dictionary.size(), exponent);
     vector<string> queries;
     queries.reserve(query_count);
     for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+        queries.push_back(GenerateZipfQuery(generator, dictionary, word_distribution, uniform_int_distribution(1, max_word_count)(generator), minus_prob));
     }
     return queries;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count, double minus_prob = 0) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count, minus_prob));
+    }
+    return queries;
+}
+
+// Журнал запросов: строка "<секунды от начала журнала>\t<запрос>", например "12.345\tcurly cat -dog".
+// Время - момент прихода запроса, по нему воспроизводятся паузы между запросами.
+struct LoggedQuery {
+    chrono::nanoseconds offset;
+    string query;
+};
+
+vector<LoggedQuery> ReadQueryLog(istream& input) {
+    vector<LoggedQuery> log;
+    string line;
+    for (int line_number = 1; getline(input, line); ++line_number) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+        const size_t tab = line.find('\t');
+        size_t parsed = 0;
+        double seconds = -1;
+        try {
+            seconds = stod(line.substr(0, tab), &parsed);
+        }
+        catch (const logic_error&) {
+        }
+        //stod принимает nan и inf, а слишком большое время не помещается в наносекунды. Граница строгая:
+        //nanoseconds::max() в double округляется вверх до 2^63 нс, и её преобразование обратно переполняется
+        const bool representable = isfinite(seconds) && seconds < chrono::duration<double>(chrono::nanoseconds::max()).count();
+        if (tab == string::npos || parsed != tab || seconds < 0 || !representable) {
+            throw invalid_argument("Query log line "s + to_string(line_number) + " is invalid"s);
+        }
+        log.push_back({ chrono::duration_cast<chrono::nanoseconds>(chrono::duration<double>(seconds)), line.substr(tab + 1) });
+    }
+    //журнал может быть склеен из нескольких файлов - порядок восстанавливается по времени
+    stable_sort(log.begin(), log.end(), [](const LoggedQuery& lhs, const LoggedQuery& rhs) {
+        return lhs.offset < rhs.offset;
+    });
+    return log;
+}
+
+void WriteQueryLog(ostream& output, const vector<LoggedQuery>& log) {
+    for (const auto& [offset, query] : log) {
+        output << to_string(chrono::duration<double>(offset).count()) << '\t' << query << '\n';
+    }
+}
+
+struct ReplayStats {
+    size_t query_count = 0;
+    chrono::nanoseconds duration{};
+    // насколько позже запланированного отправлен самый запоздавший запрос:
+    // если велико, не успевает сам process и нагрузка получилась меньше записанной
+    chrono::nanoseconds max_lag{};
+};
+
+// Воспроизводит журнал с исходными паузами между запросами, ускоренными в speedup раз,
+// и передаёт каждый запрос в process(query). process должен быстро возвращать управление,
+// например ставить запрос в очередь AsyncSearchServer, иначе паузы растягиваются.
+template <typename Process>
+ReplayStats ReplayQueryLog(const vector<LoggedQuery>& log, Process process, double speedup = 1.0) {
+    if (speedup <= 0) {
+        throw invalid_argument("Replay speedup must be positive"s);
+    }
+    ReplayStats stats;
+    const auto start = chrono::steady_clock::now();
+    const auto log_start = log.empty() ? chrono::nanoseconds{} : log.front().offset;
+    for (const auto& [offset, query] : log) {
+        const auto scheduled = start + chrono::duration_cast<chrono::nanoseconds>((offset - log_start) / speedup);
+        this_thread::sleep_until(scheduled);
+        stats.max_lag = max(stats.max_lag, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - scheduled));
+        process(query);
+        ++stats.query_count;
+    }
+    stats.duration = chrono::steady_clock::now() - start;
+    return stats;
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include "latency_histogram.h"
+
+using namespace std;
+
+namespace {
+    int HighestBit(uint64_t value) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+}
+
+HistogramSnapshot::HistogramSnapshot()
+    : counts_(LatencyHistogram::BUCKET_COUNT, 0) {
+}
+
+void HistogramSnapshot::Add(size_t bucket, uint64_t count) {
+    counts_[bucket] += count;
+    total_count_ += count;
+}
+
+HistogramSnapshot& HistogramSnapshot::operator+=(const HistogramSnapshot& other) {
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    total_count_ += other.total_count_;
+    return *this;
+}
+
+HistogramSnapshot& HistogramSnapshot::operator-=(const HistogramSnapshot& other) {
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] -= other.counts_[i];
+    }
+    total_count_ -= other.total_count_;
+    return *this;
+}
+
+uint64_t HistogramSnapshot::TotalCount() const {
+    return total_count_;
+}
+
+uint64_t HistogramSnapshot::ValueAtQuantile(double quantile) const {
+    if (total_count_ == 0) {
+        return 0;
+    }
+    //ранг значения, начиная с 1
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(clamp(quantile, 0.0, 1.0) * total_count_)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < counts_.size(); ++bucket) {
+        seen += counts_[bucket];
+        if (seen >= rank) {
+            return LatencyHistogram::BucketUpperBound(bucket);
+        }
+    }
+    return LatencyHistogram::BucketUpperBound(counts_.size() - 1);
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    const int exponent = HighestBit(value);
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    //старшие SUB_BUCKET_BITS бит после единицы - номер бакета внутри степени двойки
+    const uint64_t sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+    return static_cast<size_t>(SUB_BUCKET_COUNT * (exponent - SUB_BUCKET_BITS + 1) + sub_bucket);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t bucket) {
+    if (bucket < SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+    const int exponent = static_cast<int>(bucket / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS - 1;
+    const uint64_t sub_bucket = bucket % SUB_BUCKET_COUNT;
+    const int shift = exponent - SUB_BUCKET_BITS;
+    return ((SUB_BUCKET_COUNT + sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    counts_[BucketIndex(value)].fetch_add(1, memory_order_relaxed);
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const {
+    HistogramSnapshot snapshot;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        if (const uint64_t count = counts_[bucket].load(memory_order_relaxed); count > 0) {
+            snapshot.Add(bucket, count);
+        }
+    }
+    return snapshot;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Снимок гистограммы: обычные счётчики, которые можно складывать и вычитать (статистика за окно)
+class HistogramSnapshot {
+public:
+    HistogramSnapshot();
+
+    void Add(size_t bucket, uint64_t count);
+    HistogramSnapshot& operator+=(const HistogramSnapshot& other);
+    HistogramSnapshot& operator-=(const HistogramSnapshot& other);
+
+    uint64_t TotalCount() const;
+    // значение, не меньше которого quantile (0..1) записанных значений; с точностью до ширины бакета, 0 - пустая гистограмма
+    uint64_t ValueAtQuantile(double quantile) const;
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t total_count_ = 0;
+};
+
+// Гистограмма в духе HDR Histogram: значения до 32 хранятся точно, каждая следующая степень двойки
+// делится на 32 равных бакета, то есть относительная погрешность не больше 1/32 (~3%) на всём диапазоне.
+// Запись - одно атомарное сложение без блокировок.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{ 1 } << SUB_BUCKET_BITS;
+    // значения от 2^(MAX_EXPONENT + 1) попадают в последний бакет (для наносекунд - больше 36 минут)
+    static constexpr int MAX_EXPONENT = 41;
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKET_COUNT * (MAX_EXPONENT - SUB_BUCKET_BITS + 2);
+
+    static size_t BucketIndex(uint64_t value);
+    // наибольшее значение, попадающее в бакет
+    static uint64_t BucketUpperBound(size_t bucket);
+
+    void Record(uint64_t value);
+    HistogramSnapshot Snapshot() const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_{};
+};
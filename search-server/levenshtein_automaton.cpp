@@ -0,0 +1,76 @@
+#include <algorithm>
+#include "levenshtein_automaton.h"
+
+using namespace std;
+
+size_t Utf8CodePointLength(string_view text) {
+    const unsigned char lead = static_cast<unsigned char>(text[0]);
+    size_t length = 1;
+    if (lead >= 0xF0 && lead < 0xF8) {
+        length = 4;
+    }
+    else if (lead >= 0xE0) {
+        length = 3;
+    }
+    else if (lead >= 0xC0) {
+        length = 2;
+    }
+    return min(length, text.size());
+}
+
+uint32_t DecodeUtf8CodePoint(string_view text) {
+    const size_t length = Utf8CodePointLength(text);
+    if (length == 1) {
+        return static_cast<unsigned char>(text[0]);
+    }
+    uint32_t code_point = static_cast<unsigned char>(text[0]) & (0xFF >> (length + 1));
+    for (size_t i = 1; i < length; ++i) {
+        code_point = (code_point << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+    }
+    return code_point;
+}
+
+vector<uint32_t> DecodeUtf8(string_view text) {
+    vector<uint32_t> code_points;
+    code_points.reserve(text.size());
+    while (!text.empty()) {
+        code_points.push_back(DecodeUtf8CodePoint(text));
+        text.remove_prefix(Utf8CodePointLength(text));
+    }
+    return code_points;
+}
+
+LevenshteinAutomaton::LevenshteinAutomaton(string_view word, int max_distance)
+    : word_(DecodeUtf8(word))
+    , max_distance_(max_distance) {
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::Start() const {
+    State state(word_.size() + 1);
+    for (size_t i = 0; i < state.size(); ++i) {
+        state[i] = min(static_cast<int>(i), max_distance_ + 1);
+    }
+    return state;
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::Step(const State& state, uint32_t code_point) const {
+    State next(state.size());
+    next[0] = min(state[0] + 1, max_distance_ + 1);
+    for (size_t i = 1; i < state.size(); ++i) {
+        const int cost = word_[i - 1] == code_point ? 0 : 1;
+        next[i] = min({ state[i - 1] + cost, state[i] + 1, next[i - 1] + 1, max_distance_ + 1 });
+    }
+    return next;
+}
+
+bool LevenshteinAutomaton::IsMatch(const State& state) const {
+    return state.back() <= max_distance_;
+}
+
+bool LevenshteinAutomaton::CanMatch(const State& state) const {
+    return *min_element(state.begin(), state.end()) <= max_distance_;
+}
+
+int LevenshteinAutomaton::Distance(const State& state) const {
+    return state.back();
+}
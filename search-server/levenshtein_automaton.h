@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Автомат Левенштейна для слова: принимает слова на расстоянии не больше max_distance.
+// Состояние - строка таблицы динамического программирования, значения ограничены max_distance + 1.
+// Символы - кодовые точки UTF-8, поэтому замена кириллической буквы - одна правка, а не две.
+class LevenshteinAutomaton {
+public:
+    using State = std::vector<int>;
+
+    LevenshteinAutomaton(std::string_view word, int max_distance);
+
+    State Start() const;
+    State Step(const State& state, uint32_t code_point) const;
+
+    // слово, прочитанное до этого состояния, принимается
+    bool IsMatch(const State& state) const;
+    // у прочитанного префикса есть принимаемые продолжения
+    bool CanMatch(const State& state) const;
+    int Distance(const State& state) const;
+
+private:
+    std::vector<uint32_t> word_;
+    int max_distance_;
+};
+
+// длина в байтах первой кодовой точки text (некорректный байт - отдельный символ)
+size_t Utf8CodePointLength(std::string_view text);
+uint32_t DecodeUtf8CodePoint(std::string_view text);
+std::vector<uint32_t> DecodeUtf8(std::string_view text);
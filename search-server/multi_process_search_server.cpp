@@ -0,0 +1,283 @@
+#include "multi_process_search_server.h"
+
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "sharded_search_server.h"
+
+using namespace std;
+using namespace shard_protocol;
+
+namespace {
+    const auto CONNECT_TIMEOUT = 5s;
+    const auto CONNECT_RETRY_INTERVAL = 10ms;
+
+    //ответ без ошибки, иначе исключение из ответа
+    Reader CheckResponse(const string& response) {
+        Reader reader(response);
+        ThrowIfError(reader);
+        return reader;
+    }
+}
+
+RemoteShard::RemoteShard(string socket_path)
+    : socket_path_(move(socket_path)) {
+    MakeSocketAddress(socket_path_);
+}
+
+RemoteShard::~RemoteShard() {
+    Disconnect();
+}
+
+void RemoteShard::Send(string_view request) {
+    if (restarted_) {
+        throw runtime_error("Shard "s + socket_path_ + " was restarted and lost its documents"s);
+    }
+    if (fd_ < 0) {
+        Connect();
+    }
+    try {
+        WriteFrame(fd_, request);
+    }
+    catch (...) {
+        Disconnect();
+        throw;
+    }
+}
+
+string RemoteShard::Receive() {
+    if (fd_ < 0) {
+        throw runtime_error("Shard "s + socket_path_ + " is not connected"s);
+    }
+    string response;
+    try {
+        if (!ReadFrame(fd_, response)) {
+            throw runtime_error("Shard "s + socket_path_ + " closed the connection"s);
+        }
+    }
+    catch (...) {
+        Disconnect();
+        throw;
+    }
+    return response;
+}
+
+const string& RemoteShard::GetSocketPath() const {
+    return socket_path_;
+}
+
+void RemoteShard::AcceptRestart() {
+    restarted_ = false;
+    generation_.reset();
+}
+
+void RemoteShard::Connect() {
+    const sockaddr_un address = MakeSocketAddress(socket_path_);
+    const auto deadline = chrono::steady_clock::now() + CONNECT_TIMEOUT;
+    while (true) {
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw runtime_error("Cannot create shard socket"s);
+        }
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+            fd_ = fd;
+            uint64_t generation = 0;
+            try {
+                generation = RequestGeneration();
+            }
+            catch (...) {
+                Disconnect();
+                throw;
+            }
+            if (generation_ && *generation_ != generation) {
+                Disconnect();
+                restarted_ = true;
+                throw runtime_error("Shard "s + socket_path_ + " was restarted and lost its documents"s);
+            }
+            generation_ = generation;
+            return;
+        }
+        const int error = errno;
+        close(fd);
+        //сокета ещё нет или он не слушает: процесс шарда запускается
+        const bool starting = error == ENOENT || error == ECONNREFUSED || error == EINTR;
+        if (!starting || chrono::steady_clock::now() >= deadline) {
+            throw runtime_error("Cannot connect to shard "s + socket_path_);
+        }
+        this_thread::sleep_for(CONNECT_RETRY_INTERVAL);
+    }
+}
+
+uint64_t RemoteShard::RequestGeneration() {
+    Writer request;
+    request.Write(Request::HELLO);
+    WriteFrame(fd_, request.GetBuffer());
+    string response;
+    if (!ReadFrame(fd_, response)) {
+        throw runtime_error("Shard "s + socket_path_ + " closed the connection"s);
+    }
+    return CheckResponse(response).Read<uint64_t>();
+}
+
+void RemoteShard::Disconnect() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+MultiProcessSearchServer::Shard::Shard(string socket_path)
+    : connection(move(socket_path)) {
+}
+
+MultiProcessSearchServer::MultiProcessSearchServer(const vector<string>& socket_paths) {
+    if (socket_paths.empty()) {
+        throw invalid_argument("Shard count must be positive"s);
+    }
+    shards_.reserve(socket_paths.size());
+    for (const string& socket_path : socket_paths) {
+        shards_.push_back(make_unique<Shard>(socket_path));
+    }
+}
+
+void MultiProcessSearchServer::AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int>& ratings) {
+    Writer request;
+    request.Write(Request::ADD_DOCUMENT);
+    request.Write(static_cast<int32_t>(document_id));
+    request.Write(static_cast<uint8_t>(status));
+    request.Write(static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        request.Write(static_cast<int32_t>(rating));
+    }
+    request.WriteString(document);
+    CheckResponse(Call(document_id, request.GetBuffer()));
+}
+
+void MultiProcessSearchServer::RemoveDocument(int document_id) {
+    Writer request;
+    request.Write(Request::REMOVE_DOCUMENT);
+    request.Write(static_cast<int32_t>(document_id));
+    CheckResponse(Call(document_id, request.GetBuffer()));
+}
+
+size_t MultiProcessSearchServer::GetDocumentCount() const {
+    Writer request;
+    request.Write(Request::GET_DOCUMENT_COUNT);
+    const auto locks = LockAll();
+    size_t document_count = 0;
+    for (const string& response : Broadcast(request.GetBuffer())) {
+        document_count += static_cast<size_t>(CheckResponse(response).Read<uint64_t>());
+    }
+    return document_count;
+}
+
+size_t MultiProcessSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+size_t MultiProcessSearchServer::GetShardIndex(int document_id) const {
+    return ComputeShardIndex(document_id, shards_.size());
+}
+
+vector<Document> MultiProcessSearchServer::FindTopDocuments(const string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+vector<Document> MultiProcessSearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, status, scoring::TfIdf{});
+}
+
+void MultiProcessSearchServer::AcceptShardRestart(size_t shard_index) {
+    Shard& shard = *shards_.at(shard_index);
+    const lock_guard lock(shard.mutex);
+    shard.connection.AcceptRestart();
+}
+
+void MultiProcessSearchServer::Shutdown() {
+    Writer request;
+    request.Write(Request::SHUTDOWN);
+    const auto locks = LockAll();
+    for (const string& response : Broadcast(request.GetBuffer())) {
+        CheckResponse(response);
+    }
+}
+
+vector<unique_lock<mutex>> MultiProcessSearchServer::LockAll() const {
+    //по порядку шардов; остальные запросы блокируют один шард, поэтому взаимной блокировки нет
+    vector<unique_lock<mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        locks.emplace_back(shard->mutex);
+    }
+    return locks;
+}
+
+vector<Document> MultiProcessSearchServer::FindTopDocumentsEncoded(const string_view raw_query, DocumentStatus status, const string& encoded_scorer) const {
+    //обе фазы под одной блокировкой: между ними в шарды не добавляются документы этого координатора
+    const auto locks = LockAll();
+    Writer statistics_request;
+    statistics_request.Write(Request::COLLECT_STATISTICS);
+    statistics_request.WriteString(raw_query);
+    CorpusStatistics corpus;
+    for (const string& response : Broadcast(statistics_request.GetBuffer())) {
+        Reader reader = CheckResponse(response);
+        corpus.Merge(ReadCorpusStatistics(reader));
+    }
+
+    Writer search_request;
+    search_request.Write(Request::FIND_TOP_DOCUMENTS);
+    search_request.WriteString(raw_query);
+    search_request.Write(static_cast<uint8_t>(status));
+    const string prefix = search_request.GetBuffer() + encoded_scorer;
+    Writer encoded_corpus;
+    WriteCorpusStatistics(encoded_corpus, corpus);
+    vector<vector<Document>> shard_documents;
+    shard_documents.reserve(shards_.size());
+    for (const string& response : Broadcast(prefix + encoded_corpus.GetBuffer())) {
+        Reader reader = CheckResponse(response);
+        shard_documents.push_back(ReadDocuments(reader));
+    }
+    return MergeTopDocuments(shard_documents);
+}
+
+string MultiProcessSearchServer::Call(int document_id, string_view request) {
+    Shard& shard = *shards_[GetShardIndex(document_id)];
+    const lock_guard lock(shard.mutex);
+    shard.connection.Send(request);
+    return shard.connection.Receive();
+}
+
+vector<string> MultiProcessSearchServer::Broadcast(string_view request) const {
+    vector<exception_ptr> errors(shards_.size());
+    for (size_t index = 0; index < shards_.size(); ++index) {
+        try {
+            shards_[index]->connection.Send(request);
+        }
+        catch (...) {
+            errors[index] = current_exception();
+        }
+    }
+    vector<string> responses(shards_.size());
+    for (size_t index = 0; index < shards_.size(); ++index) {
+        if (errors[index]) {
+            continue;
+        }
+        try {
+            responses[index] = shards_[index]->connection.Receive();
+        }
+        catch (...) {
+            errors[index] = current_exception();
+        }
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+    return responses;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "scoring.h"
+#include "shard_protocol.h"
+
+// Соединение координатора с процессом шарда. Подключается при первом запросе и, пока шард
+// не открыл сокет, повторяет попытки до 5 секунд. При ошибке ввода-вывода соединение закрывается
+// и выбрасывается runtime_error; следующий запрос подключается заново. При подключении запоминается
+// поколение процесса шарда: если после переподключения оно другое, шард перезапущен и потерял документы -
+// соединение помечается потерявшим документы, и запросы выбрасывают runtime_error до AcceptRestart.
+class RemoteShard {
+public:
+    explicit RemoteShard(std::string socket_path);
+    ~RemoteShard();
+
+    RemoteShard(const RemoteShard&) = delete;
+    RemoteShard& operator=(const RemoteShard&) = delete;
+
+    // запрос и ответ разделены: координатор рассылает запрос всем шардам и только потом ждёт ответы
+    void Send(std::string_view request);
+    std::string Receive();
+
+    const std::string& GetSocketPath() const;
+
+    // снимает пометку о потере документов: следующее подключение принимает новое поколение шарда
+    void AcceptRestart();
+
+private:
+    void Connect();
+    void Disconnect();
+    // запрос HELLO по только что открытому соединению
+    uint64_t RequestGeneration();
+
+    std::string socket_path_;
+    int fd_ = -1;
+    std::optional<uint64_t> generation_;
+    bool restarted_ = false;
+};
+
+// Координатор шардов в отдельных процессах (ShardProcess или search_shard) на одной машине.
+// Документы распределяются между шардами тем же хешем id, что и в ShardedSearchServer, поиск идёт в те же
+// две фазы: сумма статистики шардов по словам запроса, затем поиск в шардах с этой статистикой,
+// поэтому выдача совпадает с одним SearchServer со всеми документами.
+// Запрос рассылается всем шардам до ожидания ответов, и шарды ищут одновременно.
+// Через границу процесса передаются только фильтр по статусу и функции ранжирования TfIdf и Bm25.
+// Ошибки запроса (invalid_argument, out_of_range) приходят от шарда тем же типом исключения,
+// недоступный шард и повреждённые сообщения - runtime_error.
+// Шард хранит документы только в памяти. Перезапуск шарда координатор замечает по смене его поколения,
+// после чего все запросы к шарду выбрасывают runtime_error, а не возвращают выдачу без его документов,
+// пока вызывающий не вызовет AcceptShardRestart и не добавит документы шарда заново.
+class MultiProcessSearchServer {
+public:
+    explicit MultiProcessSearchServer(const std::vector<std::string>& socket_paths);
+
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    size_t GetDocumentCount() const;
+    size_t GetShardCount() const;
+    size_t GetShardIndex(int document_id) const;
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+
+    //scorer - scoring::TfIdf или scoring::Bm25
+    template <typename Scorer>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status, const Scorer& scorer) const {
+        shard_protocol::Writer encoded_scorer;
+        shard_protocol::WriteScorer(encoded_scorer, scorer);
+        return FindTopDocumentsEncoded(raw_query, status, encoded_scorer.GetBuffer());
+    }
+
+    // Шард shard_index снова принимает запросы после перезапуска; его документы пропали, и вызывающий
+    // добавляет их заново через AddDocument (шард документа - GetShardIndex). Индекс вне диапазона - out_of_range
+    void AcceptShardRestart(size_t shard_index);
+
+    // просит процессы шардов завершиться
+    void Shutdown();
+
+private:
+    struct Shard {
+        explicit Shard(std::string socket_path);
+
+        //у шарда одно соединение: запросы к нему идут по очереди
+        std::mutex mutex;
+        RemoteShard connection;
+    };
+
+    std::vector<std::unique_lock<std::mutex>> LockAll() const;
+    std::vector<Document> FindTopDocumentsEncoded(const std::string_view raw_query, DocumentStatus status, const std::string& encoded_scorer) const;
+    // запрос к шарду document_id
+    std::string Call(int document_id, std::string_view request);
+    // request всем шардам, затем ответы всех шардов; вызывающий держит блокировки всех шардов.
+    // Ответы читаются и после ошибки, чтобы соединения остались согласованными, затем выбрасывается первая ошибка
+    std::vector<std::string> Broadcast(std::string_view request) const;
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <cassert>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 #include <iostream>
 
@@ -26,7 +27,7 @@ class Paginator
 public:
     Paginator() = delete;
     Paginator(const Iterator begin, const Iterator end, size_t page_size) : page_size_(page_size) {
-        if (page_size = = 0) {
+        if (page_size == 0) {
             throw std::invalid_argument("received zero page size");
         }
 
@@ -0,0 +1,55 @@
+#include "position_list.h"
+
+using namespace std;
+
+PositionList::PositionList(const allocator_type& allocator)
+    : bytes_(allocator) {
+}
+
+PositionList::PositionList(const PositionList& other, const allocator_type& allocator)
+    : bytes_(other.bytes_, allocator)
+    , last_position_(other.last_position_) {
+}
+
+PositionList::PositionList(PositionList&& other, const allocator_type& allocator)
+    : bytes_(std::move(other.bytes_), allocator)
+    , last_position_(other.last_position_) {
+}
+
+void PositionList::Append(uint32_t position) {
+    uint32_t delta = bytes_.empty() ? position : position - last_position_;
+    last_position_ = position;
+    while (delta >= 0x80) {
+        bytes_.push_back(static_cast<uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    bytes_.push_back(static_cast<uint8_t>(delta));
+}
+
+vector<uint32_t> PositionList::Decode() const {
+    vector<uint32_t> positions;
+    DecodeTo(positions);
+    return positions;
+}
+
+void PositionList::DecodeTo(vector<uint32_t>& positions) const {
+    positions.clear();
+    uint32_t position = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (const uint8_t byte : bytes_) {
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        position += delta;
+        positions.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+}
+
+size_t PositionList::ByteSize() const {
+    return bytes_.size();
+}
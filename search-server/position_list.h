@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+// Сжатый список позиций слова в документе: позиции возрастают,
+// хранятся разности соседних позиций в формате varint (7 бит на байт)
+class PositionList {
+public:
+    // в map<int, PositionList> с pmr-аллокатором байты списка берут память у ресурса map
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    PositionList() = default;
+    explicit PositionList(const allocator_type& allocator);
+    PositionList(const PositionList& other, const allocator_type& allocator);
+    PositionList(PositionList&& other, const allocator_type& allocator);
+    PositionList(const PositionList&) = default;
+    PositionList(PositionList&&) = default;
+    PositionList& operator=(const PositionList&) = default;
+    PositionList& operator=(PositionList&&) = default;
+
+    // позиции добавляются по возрастанию
+    void Append(uint32_t position);
+
+    std::vector<uint32_t> Decode() const;
+    void DecodeTo(std::vector<uint32_t>& positions) const;
+
+    size_t ByteSize() const;
+
+private:
+    std::pmr::vector<uint8_t> bytes_;
+    uint32_t last_position_ = 0;
+};
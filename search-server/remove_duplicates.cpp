@@ -9,17 +9,18 @@ void RemoveDuplicates(SearchServer& search_server) {
 void SearchServer::RemoveDuplicates() {
 	map<int, bool> select_documents; //  
 	map<int, set<string>> dictionary_documents; //    
-	set<string> doc_words;
-	for (auto& [id, words] : doc_id_word_freq_)
+	for (const int id : documents_)
 	{
 		select_documents.insert(make_pair( id , false ));
-		doc_words.clear();
-		for(auto& word : words)
+		dictionary_documents[id];
+	}
+	//      :     
+	for (auto& [word, document_freqs] : word_to_document_freqs_)
+	{
+		for (auto& [id, freq] : document_freqs)
 		{
-			doc_words.emplace(word.first);
+			dictionary_documents[id].emplace(word);
 		}
-		dictionary_documents.insert({id, doc_words });
-
 	}
 	for (auto it_sel = select_documents.begin(); it_sel != select_documents.end(); it_sel++) {
 		for (auto it_for_del = select_documents.begin(); it_for_del != select_documents.end(); it_for_del++) {
@@ -1,30 +1,88 @@
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server) : count_empty(0), search_server_(search_server) {
+RequestQueue::RequestQueue(const SearchServer& search_server)
+    : shards_(STATS_SHARD_COUNT)
+    , search_server_(search_server) {
+    created_.time = std::chrono::steady_clock::now();
+    window_start_ = created_;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
+    TRACE_SCOPE("AddFindRequest", REQUEST);
+    const auto start = std::chrono::steady_clock::now();
     std::vector<Document> result =
         search_server_.FindTopDocuments(raw_query, status);
-    SaveResult(result.size() == 0);
+    SaveResult(result.size(), std::chrono::steady_clock::now() - start);
     return result;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
-    std::vector<Document> result =
-        search_server_.FindTopDocuments(raw_query);
-    SaveResult(result.size() == 0);
-    return result;
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
+RequestQueueStats RequestQueue::GetStats() const {
+    return MakeStats(MakeSnapshot(), created_);
+}
+
+RequestQueueStats RequestQueue::TakeWindowStats() {
+    //снимок под блокировкой: иначе окно с более ранним снимком могло бы закрыться позже и счётчики ушли бы в минус
+    std::lock_guard guard(window_mutex_);
+    StatsSnapshot current = MakeSnapshot();
+    RequestQueueStats stats = MakeStats(current, window_start_);
+    window_start_ = std::move(current);
+    return stats;
+}
+
+void RequestQueue::SaveResult(size_t result_count, std::chrono::steady_clock::duration latency) {
+    StatsShard& shard = shards_[GetCurrentShard()];
+    shard.latency.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+    shard.result_counts[std::min<size_t>(result_count, MAX_RESULT_DOCUMENT_COUNT)].fetch_add(1, std::memory_order_relaxed);
+
+    //новый результат вытесняет результат запроса, сделанного min_in_day_ запросов назад
+    const uint8_t is_empty = result_count == 0 ? 1 : 0;
+    const uint64_t number = request_number_.fetch_add(1, std::memory_order_relaxed);
+    const uint8_t old_is_empty = requests_[number % min_in_day_].exchange(is_empty, std::memory_order_relaxed);
+    if (is_empty != old_is_empty) {
+        count_empty.fetch_add(is_empty ? 1 : -1, std::memory_order_relaxed);
+    }
+}
+
+size_t RequestQueue::GetCurrentShard() {
+    static std::atomic<size_t> next_shard = 0;
+    thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % STATS_SHARD_COUNT;
+    return shard;
 }
 
-void RequestQueue::SaveResult(bool is_empty){
-    requests_.emplace_back(QueryResult(is_empty));
-    if (is_empty) ++count_empty;
-    if (min_in_day_ < requests_.size())
-    {
-        if (count_empty > 0)
-            if (requests_.front().empty_request_queue) --count_empty;
-        requests_.pop_front();
+RequestQueue::StatsSnapshot RequestQueue::MakeSnapshot() const {
+    StatsSnapshot snapshot;
+    for (const StatsShard& shard : shards_) {
+        snapshot.latency += shard.latency.Snapshot();
+        for (size_t i = 0; i < shard.result_counts.size(); ++i) {
+            snapshot.result_counts[i] += shard.result_counts[i].load(std::memory_order_relaxed);
+        }
     }
+    snapshot.time = std::chrono::steady_clock::now();
+    return snapshot;
+}
 
+RequestQueueStats RequestQueue::MakeStats(const StatsSnapshot& current, const StatsSnapshot& previous) {
+    RequestQueueStats stats;
+    HistogramSnapshot latency = current.latency;
+    latency -= previous.latency;
+    for (size_t i = 0; i < stats.result_count_distribution.size(); ++i) {
+        stats.result_count_distribution[i] = current.result_counts[i] - previous.result_counts[i];
+        stats.request_count += stats.result_count_distribution[i];
+    }
+    stats.empty_count = stats.result_count_distribution[0];
+    if (stats.request_count > 0) {
+        stats.empty_rate = static_cast<double>(stats.empty_count) / stats.request_count;
+    }
+    const double seconds = std::chrono::duration<double>(current.time - previous.time).count();
+    if (seconds > 0.0) {
+        stats.queries_per_second = stats.request_count / seconds;
+    }
+    stats.latency_p50 = std::chrono::nanoseconds(latency.ValueAtQuantile(0.5));
+    stats.latency_p99 = std::chrono::nanoseconds(latency.ValueAtQuantile(0.99));
+    stats.latency_p999 = std::chrono::nanoseconds(latency.ValueAtQuantile(0.999));
+    return stats;
 }
@@ -1,31 +1,81 @@
 #pragma once
 #include "search_server.h"
-#include <deque>
+#include "latency_histogram.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 
+// Статистика запросов за период
+struct RequestQueueStats {
+    uint64_t request_count = 0;
+    uint64_t empty_count = 0;
+    double empty_rate = 0.0;
+    double queries_per_second = 0.0;
+    std::chrono::nanoseconds latency_p50{};
+    std::chrono::nanoseconds latency_p99{};
+    std::chrono::nanoseconds latency_p999{};
+    // result_count_distribution[n] - сколько запросов вернули n документов
+    std::array<uint64_t, MAX_RESULT_DOCUMENT_COUNT + 1> result_count_distribution{};
+};
+
+// Обёртка над SearchServer со статистикой запросов. Методы можно вызывать из нескольких потоков:
+// каждый поток пишет в свой набор атомарных счётчиков, наборы складываются только при чтении статистики.
 class RequestQueue {
 public:
     explicit RequestQueue(const SearchServer& search_server);
     
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+        TRACE_SCOPE("AddFindRequest", REQUEST);
+        const auto start = std::chrono::steady_clock::now();
         std::vector<Document> result =
             search_server_.FindTopDocuments(raw_query, document_predicate);
-        SaveResult(result.size() == 0);
+        SaveResult(result.size(), std::chrono::steady_clock::now() - start);
         return result;
     }
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
+    //запросы без результатов среди последних min_in_day_
     int GetNoResultRequests() const {
-        return count_empty;
+        return count_empty.load(std::memory_order_relaxed);
     }
+
+    //статистика с момента создания
+    RequestQueueStats GetStats() const;
+    //статистика с предыдущего вызова (или с момента создания)
+    RequestQueueStats TakeWindowStats();
+
 private:
-    void SaveResult(bool is_empty);
-    struct QueryResult {
-        QueryResult(bool empty) : empty_request_queue(empty) {}
-        bool empty_request_queue;
+    void SaveResult(size_t result_count, std::chrono::steady_clock::duration latency);
+
+    //счётчики одного потока (точнее, потоков с одинаковым номером набора); выровнены, чтобы не делить кэш-линию
+    struct alignas(64) StatsShard {
+        LatencyHistogram latency; //наносекунды
+        std::array<std::atomic<uint64_t>, MAX_RESULT_DOCUMENT_COUNT + 1> result_counts{};
     };
-    std::deque<QueryResult> requests_;
+    static constexpr size_t STATS_SHARD_COUNT = 16;
+    static size_t GetCurrentShard();
+
+    //сложенные счётчики всех потоков
+    struct StatsSnapshot {
+        HistogramSnapshot latency;
+        std::array<uint64_t, MAX_RESULT_DOCUMENT_COUNT + 1> result_counts{};
+        std::chrono::steady_clock::time_point time;
+    };
+    StatsSnapshot MakeSnapshot() const;
+    static RequestQueueStats MakeStats(const StatsSnapshot& current, const StatsSnapshot& previous);
+
+    //кольцо результатов последних min_in_day_ запросов: 1 - пустой результат
     const static int min_in_day_ = 1440;
-    int count_empty;
+    std::array<std::atomic<uint8_t>, min_in_day_> requests_{};
+    std::atomic<uint64_t> request_number_ = 0;
+    std::atomic<int> count_empty = 0;
+
+    std::vector<StatsShard> shards_;
+    StatsSnapshot created_;
+    std::mutex window_mutex_;
+    StatsSnapshot window_start_;
+
     const SearchServer& search_server_;
 };
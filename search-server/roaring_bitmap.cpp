@@ -0,0 +1,118 @@
+#include <algorithm>
+#include "roaring_bitmap.h"
+
+using namespace std;
+
+RoaringBitmap::RoaringBitmap(pmr::memory_resource* resource)
+    : keys_(resource)
+    , containers_(resource) {
+}
+
+void RoaringBitmap::Add(uint32_t value) {
+    const uint16_t high = static_cast<uint16_t>(value >> 16);
+    const uint16_t low = static_cast<uint16_t>(value & 0xFFFF);
+
+    auto key_it = lower_bound(keys_.begin(), keys_.end(), high);
+    const size_t index = distance(keys_.begin(), key_it);
+    if (key_it == keys_.end() || *key_it != high) {
+        keys_.insert(key_it, high);
+        containers_.insert(containers_.begin() + index, Container(containers_.get_allocator()));
+    }
+    Container& container = containers_[index];
+
+    if (!container.bits.empty()) {
+        uint64_t& word = container.bits[low / 64];
+        const uint64_t mask = uint64_t{ 1 } << (low % 64);
+        if ((word & mask) == 0) {
+            word |= mask;
+            ++container.cardinality;
+            ++cardinality_;
+        }
+        return;
+    }
+
+    auto it = lower_bound(container.array.begin(), container.array.end(), low);
+    if (it != container.array.end() && *it == low) {
+        return;
+    }
+    container.array.insert(it, low);
+    ++container.cardinality;
+    ++cardinality_;
+
+    //массив разросся - переходим на битовую карту
+    if (container.array.size() > ARRAY_CONTAINER_LIMIT) {
+        container.bits.assign(BITMAP_WORD_COUNT, 0);
+        for (const uint16_t element : container.array) {
+            container.bits[element / 64] |= uint64_t{ 1 } << (element % 64);
+        }
+        container.array.clear();
+        container.array.shrink_to_fit();
+    }
+}
+
+void RoaringBitmap::Remove(uint32_t value) {
+    const uint16_t high = static_cast<uint16_t>(value >> 16);
+    const uint16_t low = static_cast<uint16_t>(value & 0xFFFF);
+
+    auto key_it = lower_bound(keys_.begin(), keys_.end(), high);
+    if (key_it == keys_.end() || *key_it != high) {
+        return;
+    }
+    const size_t index = distance(keys_.begin(), key_it);
+    Container& container = containers_[index];
+
+    if (!container.bits.empty()) {
+        uint64_t& word = container.bits[low / 64];
+        const uint64_t mask = uint64_t{ 1 } << (low % 64);
+        if ((word & mask) == 0) {
+            return;
+        }
+        word &= ~mask;
+    }
+    else {
+        auto it = lower_bound(container.array.begin(), container.array.end(), low);
+        if (it == container.array.end() || *it != low) {
+            return;
+        }
+        container.array.erase(it);
+    }
+    --container.cardinality;
+    --cardinality_;
+
+    if (container.cardinality == 0) {
+        keys_.erase(key_it);
+        containers_.erase(containers_.begin() + index);
+    }
+    //битовая карта опустела настолько, что массив снова компактнее
+    else if (!container.bits.empty() && container.cardinality <= ARRAY_CONTAINER_LIMIT / 2) {
+        pmr::vector<uint16_t> array(container.array.get_allocator());
+        array.reserve(container.cardinality);
+        for (size_t word_index = 0; word_index < container.bits.size(); ++word_index) {
+            for (uint64_t word = container.bits[word_index]; word != 0; word &= word - 1) {
+                array.push_back(static_cast<uint16_t>(word_index * 64 + CountTrailingZeros(word)));
+            }
+        }
+        container.array = move(array);
+        container.bits.clear();
+        container.bits.shrink_to_fit();
+    }
+}
+
+bool RoaringBitmap::Contains(uint32_t value) const {
+    const uint16_t high = static_cast<uint16_t>(value >> 16);
+    const uint16_t low = static_cast<uint16_t>(value & 0xFFFF);
+
+    auto key_it = lower_bound(keys_.begin(), keys_.end(), high);
+    if (key_it == keys_.end() || *key_it != high) {
+        return false;
+    }
+    const Container& container = containers_[distance(keys_.begin(), key_it)];
+    if (!container.bits.empty()) {
+        return (container.bits[low / 64] >> (low % 64)) & 1;
+    }
+    return binary_search(container.array.begin(), container.array.end(), low);
+}
+
+size_t RoaringBitmap::Cardinality() const {
+    return cardinality_;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Сжатое множество неотрицательных целых (id документов) в духе Roaring bitmap:
+// старшие 16 бит значения выбирают контейнер, младшие 16 бит хранятся в нём
+// либо отсортированным массивом (пока элементов мало), либо битовой картой на 65536 бит.
+class RoaringBitmap {
+public:
+    // память ключей и контейнеров берётся из resource
+    explicit RoaringBitmap(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    void Add(uint32_t value);
+    void Remove(uint32_t value);
+    bool Contains(uint32_t value) const;
+    size_t Cardinality() const;
+
+    // обход значений по возрастанию
+    template <typename Function>
+    void ForEach(Function function) const {
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            const uint32_t high = static_cast<uint32_t>(keys_[i]) << 16;
+            const Container& container = containers_[i];
+            if (container.bits.empty()) {
+                for (const uint16_t low : container.array) {
+                    function(high | low);
+                }
+                continue;
+            }
+            for (size_t word_index = 0; word_index < container.bits.size(); ++word_index) {
+                uint64_t word = container.bits[word_index];
+                while (word != 0) {
+                    const int bit = CountTrailingZeros(word);
+                    function(high | static_cast<uint32_t>(word_index * 64 + bit));
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+
+private:
+    static int CountTrailingZeros(uint64_t word) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    // массив переводится в битовую карту, когда занимает больше её (4096 * 2 байта = 8 КБ)
+    static constexpr size_t ARRAY_CONTAINER_LIMIT = 4096;
+    static constexpr size_t BITMAP_WORD_COUNT = 65536 / 64;
+
+    // контейнеры берут память у того же ресурса, что и containers_
+    struct Container {
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+        explicit Container(const allocator_type& allocator)
+            : array(allocator)
+            , bits(allocator) {
+        }
+        Container(const Container& other, const allocator_type& allocator)
+            : array(other.array, allocator)
+            , bits(other.bits, allocator)
+            , cardinality(other.cardinality) {
+        }
+        Container(Container&& other, const allocator_type& allocator)
+            : array(std::move(other.array), allocator)
+            , bits(std::move(other.bits), allocator)
+            , cardinality(other.cardinality) {
+        }
+        Container(const Container&) = default;
+        Container(Container&&) = default;
+        Container& operator=(const Container&) = default;
+        Container& operator=(Container&&) = default;
+
+        std::pmr::vector<uint16_t> array; // отсортирован, используется пока bits пуст
+        std::pmr::vector<uint64_t> bits;
+        size_t cardinality = 0;
+    };
+
+    // ключи (старшие 16 бит) отсортированы, containers_[i] соответствует keys_[i]
+    std::pmr::vector<uint16_t> keys_;
+    std::pmr::vector<Container> containers_;
+    size_t cardinality_ = 0;
+};
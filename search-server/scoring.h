@@ -0,0 +1,86 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "corpus_statistics.h"
+
+// Функции ранжирования. Передаются в FindTopDocuments последним аргументом и подставляются
+// в путь поиска как параметр шаблона: по умолчанию используется TfIdf, без лишних обращений к таблице документов.
+// Релевантность документа - сумма по словам запроса InverseDocumentFreq * TermWeight.
+namespace scoring {
+    // Границы списка вхождений слова для верхней оценки его веса: наибольшее число вхождений слова
+    // в документ и наименьшая длина документа со словом. При удалении документов не уменьшаются
+    // и остаются верхними оценками.
+    struct TermBounds {
+        uint32_t max_count = 0;
+        uint32_t min_length = UINT32_MAX;
+    };
+
+    // tf - доля слова среди слов документа (без стоп-слов), idf - log(N / df)
+    struct TfIdf {
+        // нужна ли TermWeight длина документа
+        static constexpr bool USES_DOCUMENT_LENGTH = false;
+        // берутся ли число документов, их средняя длина и df из corpus вместо индекса
+        static constexpr bool USES_CORPUS_STATISTICS = false;
+
+        double InverseDocumentFreq(size_t document_count, size_t document_freq) const {
+            return log(document_count * 1.0 / document_freq);
+        }
+        double TermWeight(double term_freq, double /*document_length*/, double /*average_length*/) const {
+            return term_freq;
+        }
+        // верхняя граница TermWeight по всем документам, где доля слова не больше max_term_freq
+        double MaxTermWeight(double max_term_freq, const TermBounds& /*bounds*/, double /*average_length*/) const {
+            return max_term_freq;
+        }
+    };
+
+    // Okapi BM25: число вхождений насыщается с ростом (k1), длинные документы штрафуются (b).
+    // Длины документов и средняя длина считаются при индексации, вес - арифметика над ними.
+    struct Bm25 {
+        static constexpr bool USES_DOCUMENT_LENGTH = true;
+        static constexpr bool USES_CORPUS_STATISTICS = false;
+
+        double k1 = 1.2;
+        double b = 0.75;
+
+        // вариант с +1 под логарифмом: не уходит в минус для слов, встречающихся больше чем в половине документов
+        double InverseDocumentFreq(size_t document_count, size_t document_freq) const {
+            return log(1.0 + (document_count - document_freq + 0.5) / (document_freq + 0.5));
+        }
+        double TermWeight(double term_freq, double document_length, double average_length) const {
+            const double count = term_freq * document_length;
+            return count * (k1 + 1.0) / (count + k1 * (1.0 - b + b * document_length / average_length));
+        }
+        // Вес растёт с числом вхождений и убывает с длиной документа, поэтому не больше веса max_count вхождений
+        // в документ длины min_length. При доле слова tf вес растёт с длиной документа к пределу
+        // tf * (k1 + 1) / (tf + k1 * b / average_length) - граница, убывающая при обходе списка по убыванию tf.
+        double MaxTermWeight(double max_term_freq, const TermBounds& bounds, double average_length) const {
+            if (bounds.max_count == 0 || average_length <= 0.0) {
+                return k1 + 1.0;
+            }
+            const double by_count = TermWeight(bounds.max_count * 1.0 / bounds.min_length, bounds.min_length, average_length);
+            if (b <= 0.0) {
+                return by_count;
+            }
+            return std::min(by_count, max_term_freq * (k1 + 1.0) / (max_term_freq + k1 * b / average_length));
+        }
+    };
+
+    // Та же функция ранжирования, но idf и средняя длина документа считаются по статистике corpus,
+    // а не по индексу, в котором идёт поиск. Так шард ShardedSearchServer ранжирует документы,
+    // как если бы весь корпус был в одном индексе. Слова, которых нет в corpus, получают df индекса.
+    template <typename Scorer>
+    struct WithCorpusStatistics : Scorer {
+        static constexpr bool USES_CORPUS_STATISTICS = true;
+
+        WithCorpusStatistics(const Scorer& scorer, const CorpusStatistics& corpus)
+            : Scorer(scorer)
+            , corpus(&corpus) {
+        }
+
+        const CorpusStatistics* corpus;
+    };
+}
@@ -1,36 +1,206 @@
 ﻿#include <numeric>
 #include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <new>
+#include <tuple>
 #include "search_server.h"
-#include "log_duration.h"
+#include "trace.h"
+#include "levenshtein_automaton.h"
 
 using namespace std;
 
 // Start own function of class SearchServer
-SearchServer::SearchServer(const std::string_view stop_words_text) : SearchServer(SplitIntoWordsView(stop_words_text)) {}
+SearchServer::SearchServer(const std::string_view stop_words_text, SearchServerOptions options) : SearchServer(SplitIntoWordsView(stop_words_text), options) {}
 
-SearchServer::SearchServer(const std::string& stop_words_text) : SearchServer(SplitIntoWordsView(stop_words_text)) {}
+SearchServer::SearchServer(const std::string& stop_words_text, SearchServerOptions options) : SearchServer(SplitIntoWordsView(stop_words_text), options) {}
+
+namespace {
+    //заканчивает жизнь container без деструктора: его место занимает пустой контейнер с тем же ресурсом,
+    //а узлы прежнего остаются в пуле до разрушения пула
+    template <typename Container>
+    void AbandonContents(Container& container, pmr::memory_resource* resource) {
+        new (&container) Container(resource);
+    }
+
+    template <typename Pool>
+    pmr::memory_resource* MakePool(bool pooled, optional<Pool>& pool, pmr::memory_resource* upstream) {
+        if (!pooled) {
+            return upstream;
+        }
+        return &pool.emplace(upstream);
+    }
+}
+
+SearchServer::IndexMemory::IndexMemory(bool pooled)
+    : dictionary(MakePool(pooled, dictionary_pool, &system))
+    , inverted_index(MakePool(pooled, inverted_index_pool, &system))
+    , forward_index(MakePool(pooled, forward_index_pool, &system))
+    , document_metadata(MakePool(pooled, document_metadata_pool, &system))
+    , caches(MakePool(pooled, caches_pool, &system)) {
+}
+
+SearchServer::SearchServer(SearchServerOptions options, std::shared_ptr<IndexMemory> memory)
+    : memory_(move(memory))
+    , all_words_(&memory_->dictionary)
+    , stop_words_(&memory_->dictionary)
+    , word_to_document_freqs_(&memory_->inverted_index)
+    , word_to_impacts_(&memory_->inverted_index)
+    , word_to_term_bounds_(&memory_->inverted_index)
+    , documents_(&memory_->document_metadata)
+    , forward_index_(&memory_->forward_index)
+    , status_to_documents_(MakeStatusBitmaps(&memory_->document_metadata, make_index_sequence<tuple_size_v<StatusBitmaps>>()))
+    , word_to_document_positions_(&memory_->inverted_index)
+    , word_to_float_postings_(&memory_->inverted_index)
+    , options_(options)
+    , suggest_index_(options.suggest_cache_size, &memory_->caches) {
+}
+
+SearchServer::SearchServer(const SearchServer& other)
+    : SearchServer(other.options_, make_shared<IndexMemory>(other.options_.pooled_allocation)) {
+    //присваивание pmr-контейнеров сохраняет ресурс памяти левой части
+    all_words_ = other.all_words_;
+    stop_words_ = other.stop_words_;
+    documents_ = other.documents_;
+    status_to_documents_ = other.status_to_documents_;
+    suggest_index_ = other.suggest_index_;
+
+    //ключи-string_view переводятся на строки своего словаря; исходные map упорядочены, вставка - в конец
+    const auto own_word = [this](string_view word) {
+        return string_view(*all_words_.find(word));
+    };
+    for (const auto& [word, document_freqs] : other.word_to_document_freqs_) {
+        word_to_document_freqs_.emplace_hint(word_to_document_freqs_.end(), own_word(word), document_freqs);
+    }
+    if (options_.forward_index) {
+        //порядковые номера у копии DocumentTable те же
+        for (const int document_id : documents_) {
+            const DocumentTable::Ordinal ordinal = documents_.Find(document_id);
+            vector<ForwardIndex::Word> words;
+            for (const ForwardIndex::Word word : other.forward_index_.Get(ordinal)) {
+                words.push_back(&*all_words_.find(*word));
+            }
+            forward_index_.Set(ordinal, move(words));
+        }
+    }
+    for (const auto& [word, impacts] : other.word_to_impacts_) {
+        word_to_impacts_.emplace_hint(word_to_impacts_.end(), own_word(word), impacts);
+    }
+    for (const auto& [word, bounds] : other.word_to_term_bounds_) {
+        word_to_term_bounds_.emplace_hint(word_to_term_bounds_.end(), own_word(word), bounds);
+    }
+    for (const auto& [word, positions] : other.word_to_document_positions_) {
+        word_to_document_positions_.emplace_hint(word_to_document_positions_.end(), own_word(word), positions);
+    }
+    for (const auto& [word, float_postings] : other.word_to_float_postings_) {
+        word_to_float_postings_.emplace_hint(word_to_float_postings_.end(), own_word(word), float_postings);
+    }
+}
+
+//memory_ копируется, а не перемещается: опустевшие контейнеры other до пересоздания сохраняют свои ресурсы памяти
+SearchServer::SearchServer(SearchServer&& other) noexcept
+    : memory_(other.memory_)
+    , all_words_(move(other.all_words_))
+    , stop_words_(move(other.stop_words_))
+    , word_to_document_freqs_(move(other.word_to_document_freqs_))
+    , word_to_impacts_(move(other.word_to_impacts_))
+    , word_to_term_bounds_(move(other.word_to_term_bounds_))
+    , documents_(move(other.documents_))
+    , forward_index_(move(other.forward_index_))
+    , status_to_documents_(move(other.status_to_documents_))
+    , word_to_document_positions_(move(other.word_to_document_positions_))
+    , word_to_float_postings_(move(other.word_to_float_postings_))
+    , options_(other.options_)
+    , suggest_index_(move(other.suggest_index_)) {
+    //ресурс памяти pmr-контейнера не меняется присваиванием, поэтому other пересоздаётся целиком: иначе его новые
+    //документы учитывались бы в памяти этого сервера. Нехватка памяти под новые счётчики завершает программу
+    auto memory = make_shared<IndexMemory>(options_.pooled_allocation);
+    other.~SearchServer();
+    new (&other) SearchServer(options_, move(memory));
+}
+
+SearchServer::~SearchServer() {
+    if (!options_.pooled_allocation) {
+        return;
+    }
+    //обход узлов map и set при разрушении стоил бы столько же, сколько их построение. Все узлы лежат в пулах memory_,
+    //пулы возвращают свои блоки целиком, поэтому элементы не разрушаются: у них нет других ресурсов, кроме памяти.
+    //Индекс автодополнения разрушается обычно - его пустой SuggestIndex выделяет память
+    AbandonContents(word_to_float_postings_, &memory_->inverted_index);
+    AbandonContents(word_to_document_positions_, &memory_->inverted_index);
+    for (RoaringBitmap& documents : status_to_documents_) {
+        AbandonContents(documents, &memory_->document_metadata);
+    }
+    AbandonContents(forward_index_, &memory_->forward_index);
+    AbandonContents(documents_, &memory_->document_metadata);
+    AbandonContents(word_to_term_bounds_, &memory_->inverted_index);
+    AbandonContents(word_to_impacts_, &memory_->inverted_index);
+    AbandonContents(word_to_document_freqs_, &memory_->inverted_index);
+    AbandonContents(stop_words_, &memory_->dictionary);
+    AbandonContents(all_words_, &memory_->dictionary);
+}
 
 void SearchServer::AddDocument(int document_id, const std::string_view raw_document, DocumentStatus status, const std::vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || documents_.Contains(document_id)) {
         throw std::invalid_argument("Invalid document_id"s);
     }
     auto words = SplitIntoWordsNoStop(raw_document);
 
-    auto& doc_id = doc_id_word_freq_[document_id];
-
+    //различные слова документа - строки словаря
+    vector<ForwardIndex::Word> document_words;
     const double inv_word_count = 1.0 / static_cast<double>(words.size());
     for (const auto& word_view : words) {
-        string_view word_v = static_cast<std::string_view>(*(all_words_.insert(string(word_view)).first));
-        word_to_document_freqs_[word_v][document_id] += inv_word_count;
-        doc_id[word_to_document_freqs_.find(word_v)->first] += inv_word_count;
+        auto it_word = all_words_.lower_bound(word_view);
+        if (it_word == all_words_.end() || *it_word != word_view) {
+            it_word = all_words_.emplace_hint(it_word, word_view);
+        }
+        const auto [it_freq, inserted] = word_to_document_freqs_[*it_word].emplace(document_id, 0.0);
+        it_freq->second += inv_word_count;
+        if (inserted) {
+            document_words.push_back(&*it_word);
+        }
+    }
+    for (const ForwardIndex::Word word : document_words) {
+        const auto& [word_v, document_freqs] = *word_to_document_freqs_.find(*word);
+        const double term_freq = document_freqs.at(document_id);
+        word_to_impacts_[word_v].emplace(term_freq, document_id);
+        scoring::TermBounds& bounds = word_to_term_bounds_[word_v];
+        bounds.max_count = max(bounds.max_count, static_cast<uint32_t>(llround(term_freq * words.size())));
+        bounds.min_length = min(bounds.min_length, static_cast<uint32_t>(words.size()));
+        suggest_index_.Update(word_v, document_freqs.size());
+    }
+    if (options_.positional_index) {
+        uint32_t position = 0;
+        for (const std::string_view word : SplitIntoWordsView(raw_document)) {
+            if (!IsStopWord(word)) {
+                word_to_document_positions_[word_to_document_freqs_.find(word)->first][document_id].Append(position);
+            }
+            ++position;
+        }
     }
 
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
-    document_ids_.insert(document_id);
+    const DocumentTable::Ordinal ordinal = documents_.Add(document_id, ComputeAverageRating(ratings), status, static_cast<uint32_t>(words.size()));
+    if (options_.float_postings) {
+        for (const ForwardIndex::Word word : document_words) {
+            const auto& [word_v, document_freqs] = *word_to_document_freqs_.find(*word);
+            word_to_float_postings_[word_v].Set(ordinal, static_cast<float>(document_freqs.at(document_id)));
+        }
+    }
+    if (options_.forward_index) {
+        forward_index_.Set(ordinal, move(document_words));
+    }
+    status_to_documents_[static_cast<size_t>(status)].Add(document_id);
 }
 
 size_t SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return documents_.Size();
+}
+
+std::vector<std::string_view> SearchServer::Suggest(const std::string_view prefix, size_t k) const {
+    if (!IsValidWord(prefix)) {
+        throw std::invalid_argument("Suggest prefix "s + string(prefix) + " is invalid"s);
+    }
+    return suggest_index_.Suggest(prefix, k);
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -41,7 +211,7 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 }
 
 bool SearchServer::IsStopWord(const std::string& word) const {
-    return stop_words_.count(word) > 0;
+    return IsStopWord(std::string_view(word));
 }
 
 bool SearchServer::IsStopWord(const std::string_view word) const {
@@ -55,23 +225,82 @@ bool SearchServer::IsValidWord(const std::string_view word) {
         });
 }
 
-std::set<int>::iterator SearchServer::begin() {
-    return document_ids_.begin();
+DocumentTable::IdIterator SearchServer::begin() const {
+    return documents_.begin();
+}
+DocumentTable::IdIterator SearchServer::end() const {
+    return documents_.end();
+}
+
+DocumentTable::IdIterator SearchServer::cbegin() const {
+    return documents_.begin();
 }
-std::set<int>::iterator SearchServer::end() {
-    return document_ids_.end();
+DocumentTable::IdIterator SearchServer::cend() const {
+    return documents_.end();
 }
 
-std::set<int>::iterator SearchServer::cbegin() const {
-    return document_ids_.begin();
+map<string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    map<string_view, double> word_freqs;
+    const DocumentTable::Ordinal ordinal = documents_.Find(document_id);
+    if (ordinal == DocumentTable::NPOS) {
+        return word_freqs;
+    }
+    for (const string_view word : GetDocumentWords(document_id, ordinal)) {
+        const auto& [word_v, document_freqs] = *word_to_document_freqs_.find(word);
+        word_freqs.emplace_hint(word_freqs.end(), word_v, document_freqs.at(document_id));
+    }
+    return word_freqs;
+}
+
+CorpusStatistics SearchServer::CollectCorpusStatistics(const std::string_view raw_query) const {
+    const auto query_lease = ParseQueryView(raw_query);
+    const auto& query = *query_lease;
+    CorpusStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    statistics.total_length = documents_.TotalLength();
+    for (const string_view word : query.plus_words) {
+        if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+            statistics.word_document_freqs.emplace(word, it->second.size());
+        }
+    }
+    for (const string_view prefix : query.plus_prefixes) {
+        if (const size_t document_freq = MergePrefixPostings(prefix).size(); document_freq > 0) {
+            statistics.prefix_document_freqs.emplace(prefix, document_freq);
+        }
+    }
+    for (const auto& expansion : ExpandFuzzyWords(query)) {
+        statistics.word_document_freqs.emplace(expansion.word, expansion.document_freqs->size());
+    }
+    return statistics;
 }
-std::set<int>::iterator SearchServer::cend() const {
-    return document_ids_.end();
+
+vector<string_view> SearchServer::GetDocumentWords(int document_id, DocumentTable::Ordinal ordinal) const {
+    vector<string_view> words;
+    if (options_.forward_index) {
+        const auto& document_words = forward_index_.Get(ordinal);
+        words.reserve(document_words.size());
+        for (const ForwardIndex::Word word : document_words) {
+            words.push_back(*word);
+        }
+        return words;
+    }
+    for (const auto& [word, document_freqs] : word_to_document_freqs_) {
+        if (document_freqs.count(document_id) > 0) {
+            words.push_back(word);
+        }
+    }
+    return words;
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const map<string_view, double> empty = {};
-    return (doc_id_word_freq_.count(document_id) == 0 ? empty : doc_id_word_freq_.at(document_id));
+MemoryStats SearchServer::GetMemoryStats() const {
+    MemoryStats stats;
+    stats.dictionary = memory_->dictionary.GetBytesInUse();
+    stats.inverted_index = memory_->inverted_index.GetBytesInUse();
+    stats.forward_index = memory_->forward_index.GetBytesInUse();
+    stats.document_metadata = memory_->document_metadata.GetBytesInUse();
+    stats.caches = memory_->caches.GetBytesInUse();
+    stats.system = memory_->system.GetBytesInUse();
+    return stats;
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const {
@@ -79,10 +308,7 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::seq, raw_query,
-        [status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) {
-            return document_status == status;
-        });
+    return FindTopDocuments(std::execution::seq, raw_query, status);
 }
 
 void SearchServer::RemoveDocument(int document_id) {
@@ -105,25 +331,170 @@ std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::stri
     return words;
 }
 
-SearchServer::QueryView SearchServer::ParseQueryView(const std::string_view text) const {
-    QueryView result;
-    auto words = SplitIntoWordsView(text);
+SearchServer::QueryViewLease::QueryViewLease() {
+    auto& pool = GetQueryBuffersPool();
+    if (pool.empty()) {
+        buffers_ = make_unique<QueryBuffers>();
+    }
+    else {
+        buffers_ = move(pool.back());
+        pool.pop_back();
+    }
+}
+
+SearchServer::QueryViewLease::~QueryViewLease() {
+    //буферов в пуле не больше, чем бывает одновременно вложенных разборов
+    const size_t MAX_POOLED_BUFFERS = 8;
+    auto& pool = GetQueryBuffersPool();
+    if (buffers_ && pool.size() < MAX_POOLED_BUFFERS) {
+        pool.push_back(move(buffers_));
+    }
+}
+
+std::vector<std::unique_ptr<SearchServer::QueryBuffers>>& SearchServer::GetQueryBuffersPool() {
+    thread_local std::vector<std::unique_ptr<QueryBuffers>> pool;
+    return pool;
+}
 
-    result.plus_words.reserve(words.size());
-    result.minus_words.reserve(words.size());
+SearchServer::QueryViewLease SearchServer::ParseQueryView(const std::string_view text) const {
+    TRACE_SCOPE("ParseQuery", PARSE);
+    QueryViewLease lease;
+    switch (ParseQueryView(text, *lease, lease.Words())) {
+    case QueryParseStatus::OK:
+        return lease;
+    case QueryParseStatus::INVALID_CHARACTER:
+        throw std::invalid_argument("Word "s + string(text) + " is invalid"s);
+    case QueryParseStatus::INVALID_WORD:
+        throw std::invalid_argument("Query word "s + string(text) + " is invalid"s);
+    case QueryParseStatus::INVALID_MINUS_WORD:
+        throw std::invalid_argument("Query minus-word "s + string(text) + " is invalid"s);
+    case QueryParseStatus::INVALID_PREFIX:
+        throw std::invalid_argument("Query prefix "s + string(text) + " is invalid"s);
+    case QueryParseStatus::INVALID_FUZZY_WORD:
+        throw std::invalid_argument("Query fuzzy word "s + string(text) + " is invalid"s);
+    case QueryParseStatus::INVALID_PHRASE:
+        throw std::invalid_argument("Query phrase "s + string(text) + " is invalid"s);
+    case QueryParseStatus::MINUS_WORD_IN_PHRASE:
+        throw std::invalid_argument("Query phrase "s + string(text) + " can't contain minus-words"s);
+    case QueryParseStatus::UNCLOSED_PHRASE:
+        throw std::invalid_argument("Query phrase in "s + string(text) + " is not closed"s);
+    case QueryParseStatus::PHRASES_DISABLED:
+        throw std::invalid_argument("Phrase queries require SearchServerOptions::positional_index"s);
+    }
+    throw std::logic_error("Unknown query parse status"s);
+}
+
+QueryParseStatus SearchServer::ValidateQuery(const std::string_view raw_query) const {
+    QueryViewLease lease;
+    return ParseQueryView(raw_query, *lease, lease.Words());
+}
+
+QueryParseStatus SearchServer::ParseQueryView(const std::string_view text, QueryView& result, std::vector<std::string_view>& words) const {
+    //clear сохраняет ёмкость векторов
+    result.plus_words.clear();
+    result.minus_words.clear();
+    result.plus_prefixes.clear();
+    result.minus_prefixes.clear();
+    result.fuzzy_words.clear();
+    result.phrase_words.clear();
+    result.phrases.clear();
+    if (!SplitIntoWordsView(text, words)) {
+        return QueryParseStatus::INVALID_CHARACTER;
+    }
+
+    bool in_phrase = false;
+    uint32_t phrase_offset = 0;
     for (auto& word : words) {
+        //фраза: "white cat" или "white cat"~N
+        if (!in_phrase && word[0] == '"') {
+            word.remove_prefix(1);
+            in_phrase = true;
+            phrase_offset = 0;
+            result.phrases.push_back({ result.phrase_words.size(), 0, 0 });
+        }
+        if (in_phrase) {
+            bool is_last = false;
+            if (const size_t quote = word.find('"'); quote != string_view::npos) {
+                const string_view suffix = word.substr(quote + 1);
+                word = word.substr(0, quote);
+                if (!suffix.empty()) {
+                    uint32_t slop = 0;
+                    const auto [end, error] = from_chars(suffix.data() + 1, suffix.data() + suffix.size(), slop);
+                    if (suffix[0] != '~' || error != std::errc() || end != suffix.data() + suffix.size()) {
+                        return QueryParseStatus::INVALID_PHRASE;
+                    }
+                    result.phrases.back().slop = slop;
+                }
+                is_last = true;
+            }
+            if (!word.empty()) {
+                if (word[0] == '-') {
+                    return QueryParseStatus::MINUS_WORD_IN_PHRASE;
+                }
+                if (!IsStopWord(word)) {
+                    result.phrase_words.push_back({ word, phrase_offset });
+                    result.plus_words.emplace_back(word);
+                }
+                ++phrase_offset;
+            }
+            if (is_last) {
+                in_phrase = false;
+                Phrase& phrase = result.phrases.back();
+                phrase.word_count = result.phrase_words.size() - phrase.first_word;
+                //фраза из одних стоп-слов ничего не ограничивает
+                if (phrase.word_count == 0) {
+                    result.phrases.pop_back();
+                }
+            }
+            continue;
+        }
+
         bool is_minus = false;
         if (word[0] == '-') {
             is_minus = true;
             word.remove_prefix(1);
             if (word.empty() || word[0] == '-') {
-                throw std::invalid_argument("Query minus-word "s + string(text) + " is invalid"s);
+                return QueryParseStatus::INVALID_MINUS_WORD;
             }
         }
         else
             if (word.empty()) {
-                throw std::invalid_argument("Query word "s + string(text) + " is invalid"s);
+                return QueryParseStatus::INVALID_WORD;
+            }
+        //префикс: cat*
+        if (word.back() == '*') {
+            word.remove_suffix(1);
+            if (word.empty()) {
+                return QueryParseStatus::INVALID_PREFIX;
+            }
+            (is_minus ? result.minus_prefixes : result.plus_prefixes).emplace_back(word);
+            continue;
+        }
+        //слово с опечатками: кот~ (одна правка) или кот~2; остальные слова с ~ - обычные слова
+        if (const size_t tilde = word.rfind('~'); tilde != string_view::npos
+            && all_of(word.begin() + tilde + 1, word.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            const string_view distance = word.substr(tilde + 1);
+            word = word.substr(0, tilde);
+            int max_distance = 1;
+            if (!distance.empty()) {
+                const auto [end, error] = from_chars(distance.data(), distance.data() + distance.size(), max_distance);
+                if (error != std::errc() || end != distance.data() + distance.size()) {
+                    max_distance = -1;
+                }
+            }
+            if (is_minus || word.empty() || max_distance < 0 || max_distance > MAX_FUZZY_EDIT_DISTANCE) {
+                return QueryParseStatus::INVALID_FUZZY_WORD;
             }
+            if (!IsStopWord(word)) {
+                if (max_distance == 0) {
+                    result.plus_words.emplace_back(word);
+                }
+                else {
+                    result.fuzzy_words.push_back({ word, max_distance });
+                }
+            }
+            continue;
+        }
         if (IsStopWord(word)) {
             continue;
         }
@@ -135,7 +506,203 @@ SearchServer::QueryView SearchServer::ParseQueryView(const std::string_view text
             result.plus_words.emplace_back(word);
         }
     }
-    return result;
+    if (in_phrase) {
+        return QueryParseStatus::UNCLOSED_PHRASE;
+    }
+    if (!result.phrases.empty() && !options_.positional_index) {
+        return QueryParseStatus::PHRASES_DISABLED;
+    }
+    //отсортирован, уникален
+    sort(result.plus_prefixes.begin(), result.plus_prefixes.end());
+    result.plus_prefixes.erase(unique(result.plus_prefixes.begin(), result.plus_prefixes.end()), result.plus_prefixes.end());
+    return QueryParseStatus::OK;
+}
+
+std::vector<std::pair<int, double>> SearchServer::MergePrefixPostings(const std::string_view prefix) const {
+    TRACE_SCOPE("MergePrefixPostings", LOOKUP);
+    using Cursor = pair<DocumentFreqs::const_iterator, DocumentFreqs::const_iterator>;
+    vector<Cursor> cursors;
+    ForEachWordWithPrefix(prefix, options_.max_prefix_expansions, [&cursors](string_view, const DocumentFreqs& document_freqs) {
+        cursors.emplace_back(document_freqs.begin(), document_freqs.end());
+    });
+
+    //k-путевое слияние: куча курсоров с наименьшим текущим id на вершине
+    auto greater_id = [](const Cursor& lhs, const Cursor& rhs) {
+        return lhs.first->first > rhs.first->first;
+    };
+    make_heap(cursors.begin(), cursors.end(), greater_id);
+    vector<pair<int, double>> merged;
+    while (!cursors.empty()) {
+        pop_heap(cursors.begin(), cursors.end(), greater_id);
+        Cursor& cursor = cursors.back();
+        const auto& [document_id, term_freq] = *cursor.first;
+        if (!merged.empty() && merged.back().first == document_id) {
+            merged.back().second += term_freq;
+        }
+        else {
+            merged.emplace_back(document_id, term_freq);
+        }
+        if (++cursor.first == cursor.second) {
+            cursors.pop_back();
+        }
+        else {
+            push_heap(cursors.begin(), cursors.end(), greater_id);
+        }
+    }
+    return merged;
+}
+
+vector<SearchServer::FuzzyExpansion> SearchServer::ExpandFuzzyWord(const FuzzyWord& fuzzy_word) const {
+    TRACE_SCOPE("ExpandFuzzyWord", LOOKUP);
+    const LevenshteinAutomaton automaton(fuzzy_word.word, fuzzy_word.max_distance);
+    vector<FuzzyExpansion> expansions;
+
+    //обход словаря как дерева префиксов: дети prefix - различные следующие символы слов с этим префиксом,
+    //переход к следующему ребёнку - поиск первого слова после всех слов с префиксом prefix + символ
+    string prefix;
+    function<void(const LevenshteinAutomaton::State&)> walk = [&](const LevenshteinAutomaton::State& state) {
+        auto it = word_to_document_freqs_.lower_bound(prefix);
+        if (it != word_to_document_freqs_.end() && it->first == prefix) {
+            if (automaton.IsMatch(state)) {
+                expansions.push_back({ it->first, &it->second, automaton.Distance(state) });
+            }
+            ++it;
+        }
+        const size_t prefix_size = prefix.size();
+        while (it != word_to_document_freqs_.end() && it->first.substr(0, prefix_size) == prefix) {
+            const string_view rest = it->first.substr(prefix_size);
+            const string_view symbol = rest.substr(0, Utf8CodePointLength(rest));
+            prefix.append(symbol);
+            const auto next_state = automaton.Step(state, DecodeUtf8CodePoint(symbol));
+            if (automaton.CanMatch(next_state)) {
+                walk(next_state);
+            }
+            //наименьшая строка, большая всех строк с префиксом prefix + символ
+            while (prefix.size() > prefix_size && static_cast<unsigned char>(prefix.back()) == 0xFF) {
+                prefix.pop_back();
+            }
+            if (prefix.size() == prefix_size) {
+                break;
+            }
+            ++prefix.back();
+            it = word_to_document_freqs_.lower_bound(prefix);
+            prefix.resize(prefix_size);
+        }
+        prefix.resize(prefix_size);
+    };
+    walk(automaton.Start());
+
+    sort(expansions.begin(), expansions.end(), [](const FuzzyExpansion& lhs, const FuzzyExpansion& rhs) {
+        if (lhs.distance != rhs.distance) {
+            return lhs.distance < rhs.distance;
+        }
+        return lhs.document_freqs->size() > rhs.document_freqs->size();
+    });
+    if (expansions.size() > options_.max_fuzzy_expansions) {
+        expansions.resize(options_.max_fuzzy_expansions);
+    }
+    return expansions;
+}
+
+vector<SearchServer::FuzzyExpansion> SearchServer::ExpandFuzzyWords(const QueryView& query) const {
+    vector<FuzzyExpansion> expansions;
+    for (const auto& fuzzy_word : query.fuzzy_words) {
+        const auto word_expansions = ExpandFuzzyWord(fuzzy_word);
+        expansions.insert(expansions.end(), word_expansions.begin(), word_expansions.end());
+    }
+    sort(expansions.begin(), expansions.end(), [](const FuzzyExpansion& lhs, const FuzzyExpansion& rhs) {
+        return tie(lhs.word, lhs.distance) < tie(rhs.word, rhs.distance);
+    });
+    expansions.erase(unique(expansions.begin(), expansions.end(), [](const FuzzyExpansion& lhs, const FuzzyExpansion& rhs) {
+        return lhs.word == rhs.word;
+    }), expansions.end());
+    return expansions;
+}
+
+void SearchServer::AppendDocumentFuzzyWords(const vector<FuzzyWord>& fuzzy_words, int document_id, vector<string_view>& words) const {
+    for (const auto& fuzzy_word : fuzzy_words) {
+        for (const auto& expansion : ExpandFuzzyWord(fuzzy_word)) {
+            if (expansion.document_freqs->count(document_id) > 0) {
+                words.push_back(expansion.word);
+            }
+        }
+    }
+}
+
+string_view SearchServer::GetLastPrefixExpansion(const string_view prefix) const {
+    string_view last_word;
+    ForEachWordWithPrefix(prefix, options_.max_prefix_expansions, [&last_word](string_view word, const DocumentFreqs&) {
+        last_word = word;
+    });
+    return last_word;
+}
+
+void SearchServer::AppendDocumentWordsWithPrefix(const vector<string_view>& prefixes, DocumentTable::Ordinal ordinal, vector<string_view>& words) const {
+    const auto& document_words = forward_index_.Get(ordinal);
+    for (const string_view prefix : prefixes) {
+        //только слова, по которым FindTopDocuments считает релевантность
+        const string_view last_word = GetLastPrefixExpansion(prefix);
+        for (auto it = forward_index_.LowerBound(ordinal, prefix);
+             it != document_words.end() && string_view(**it) <= last_word && string_view(**it).substr(0, prefix.size()) == prefix; ++it) {
+            words.push_back(**it);
+        }
+    }
+}
+
+bool SearchServer::HasDocumentWordWithPrefix(const vector<string_view>& prefixes, DocumentTable::Ordinal ordinal) const {
+    const auto& document_words = forward_index_.Get(ordinal);
+    return any_of(prefixes.begin(), prefixes.end(), [this, ordinal, &document_words](const string_view prefix) {
+        const auto it = forward_index_.LowerBound(ordinal, prefix);
+        return it != document_words.end() && string_view(**it).substr(0, prefix.size()) == prefix;
+    });
+}
+
+bool SearchServer::MatchesPhrases(const QueryView& query, int document_id) const {
+    vector<vector<uint32_t>> positions;
+    for (const Phrase& phrase : query.phrases) {
+        positions.resize(phrase.word_count);
+        for (size_t i = 0; i < phrase.word_count; ++i) {
+            const auto it_word = word_to_document_positions_.find(query.phrase_words[phrase.first_word + i].word);
+            if (it_word == word_to_document_positions_.end()) {
+                return false;
+            }
+            const auto it_document = it_word->second.find(document_id);
+            if (it_document == it_word->second.end()) {
+                return false;
+            }
+            it_document->second.DecodeTo(positions[i]);
+        }
+
+        //для каждого вхождения первого слова жадно берём ближайшие допустимые вхождения следующих:
+        //так расстояние между первым и последним словом минимально
+        const PhraseWord* words = &query.phrase_words[phrase.first_word];
+        const uint32_t phrase_length = words[phrase.word_count - 1].offset - words[0].offset;
+        bool found = false;
+        for (const uint32_t start : positions[0]) {
+            uint32_t position = start;
+            bool complete = true;
+            for (size_t i = 1; i < phrase.word_count; ++i) {
+                const uint32_t min_position = position + (words[i].offset - words[i - 1].offset);
+                const auto it = lower_bound(positions[i].begin(), positions[i].end(), min_position);
+                if (it == positions[i].end()) {
+                    complete = false;
+                    break;
+                }
+                position = *it;
+            }
+            if (!complete) {
+                break; //для более поздних вхождений первого слова продолжения тоже не найдётся
+            }
+            if (position - start - phrase_length <= phrase.slop) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
 }
 
 MatchOfDocument SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
@@ -143,73 +710,207 @@ MatchOfDocument SearchServer::MatchDocument(const std::string_view raw_query, in
 }
 
 MatchOfDocument SearchServer::MatchDocument(execution::sequenced_policy, const std::string_view raw_query, int document_id) const {
-    if (!document_ids_.count(document_id)) {
+    return MatchDocumentWords(raw_query, document_id, false);
+}
+
+MatchOfDocument SearchServer::MatchDocument(execution::parallel_policy, const std::string_view raw_query, int document_id) const {
+    return MatchDocumentWords(raw_query, document_id, true);
+}
+
+MatchOfDocument SearchServer::MatchDocumentWords(const std::string_view raw_query, int document_id, bool parallel) const {
+    const DocumentTable::Ordinal ordinal = documents_.Find(document_id);
+    if (ordinal == DocumentTable::NPOS) {
         throw std::out_of_range("Передан несуществующий document_id "s + to_string(document_id));
     }
-    auto query = ParseQueryView(raw_query);
+    if (!options_.forward_index) {
+        //без прямого индекса документ ищется в списках слов запроса
+        return move(MatchDocumentsBatch(raw_query, { document_id }, parallel).front());
+    }
+    const DocumentStatus status = documents_.GetStatus(ordinal);
+    const auto query_lease = ParseQueryView(raw_query);
+    auto& query = *query_lease;
+    TRACE_SCOPE("MatchDocument", MATCH);
+    const auto& document_words = forward_index_.Get(ordinal); //отсортированы
+
+    //минус-слова проверяются первыми: с ними документ не совпадает ни с одним словом
+    if (any_of(query.minus_words.begin(), query.minus_words.end(), [this, ordinal](const string_view word) {
+            return forward_index_.Find(ordinal, word) != nullptr;
+        })
+        || HasDocumentWordWithPrefix(query.minus_prefixes, ordinal)
+        || !MatchesPhrases(query, document_id)) {
+        return { vector<string_view>{}, status };
+    }
 
     //отсортирован, уникален
     sort(query.plus_words.begin(), query.plus_words.end());
     query.plus_words.resize(std::distance(query.plus_words.begin(), std::unique(query.plus_words.begin(), query.plus_words.end())));
 
-    for (auto& minus_word : query.minus_words)
-        if (word_to_document_freqs_.find(minus_word)->second.count(document_id))
-            return { {}, documents_.at(document_id).status };
-
-    vector<string_view> matched_words; //подобранные слова
-    matched_words.reserve(query.plus_words.size());
-    for_each(query.plus_words.begin(), query.plus_words.end(), [this, document_id, &matched_words](const auto& word) { //перебор слов запроса
-        if (word_to_document_freqs_.count(word) != 0) {
-            const auto& word_to_document = word_to_document_freqs_.find(word);
-            if (word_to_document->second.count(document_id)) { //если слово-запрос в составе документа(document_id)
-                matched_words.emplace_back(word_to_document->first);
+    //найденные слова берутся из словаря документа: они живут вместе с сервером, а не с текстом запроса
+    vector<string_view> matched_words;
+    if (parallel && query.plus_words.size() >= MATCH_DOCUMENT_PARALLEL_THRESHOLD) {
+        vector<string_view> found_words(query.plus_words.size());
+        transform(execution::par, query.plus_words.begin(), query.plus_words.end(), found_words.begin(),
+            [this, ordinal](const string_view word) {
+                const ForwardIndex::Word found = forward_index_.Find(ordinal, word);
+                return found == nullptr ? string_view{} : string_view(*found);
+            });
+        matched_words.reserve(found_words.size());
+        copy_if(found_words.begin(), found_words.end(), back_inserter(matched_words),
+            [](const string_view word) { return !word.empty(); });
+    }
+    else if (query.plus_words.size() * 8 < document_words.size()) {
+        //короткий запрос к длинному документу - поиск каждого слова
+        for (const string_view word : query.plus_words) {
+            if (const ForwardIndex::Word found = forward_index_.Find(ordinal, word)) {
+                matched_words.push_back(*found);
             }
         }
-        });
+    }
+    else {
+        //слияние двух отсортированных списков
+        auto it_document = document_words.begin();
+        auto it_query = query.plus_words.begin();
+        while (it_document != document_words.end() && it_query != query.plus_words.end()) {
+            const string_view document_word = **it_document;
+            if (document_word < *it_query) {
+                ++it_document;
+            }
+            else if (*it_query < document_word) {
+                ++it_query;
+            }
+            else {
+                matched_words.push_back(document_word);
+                ++it_document;
+                ++it_query;
+            }
+        }
+    }
 
-    sort(matched_words.begin(), matched_words.end());
-    matched_words.resize(std::distance(matched_words.begin(), std::unique(matched_words.begin(), matched_words.end())));
+    const size_t exact_count = matched_words.size();
+    AppendDocumentWordsWithPrefix(query.plus_prefixes, ordinal, matched_words);
+    AppendDocumentFuzzyWords(query.fuzzy_words, document_id, matched_words);
+    if (matched_words.size() != exact_count) {
+        sort(matched_words.begin(), matched_words.end());
+        matched_words.resize(std::distance(matched_words.begin(), std::unique(matched_words.begin(), matched_words.end())));
+    }
 
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, status };
 }
 
-MatchOfDocument SearchServer::MatchDocument(execution::parallel_policy, const std::string_view raw_query, int document_id) const {
-    if (!document_ids_.count(document_id)) {
-        throw std::out_of_range("Передан несуществующий document_id "s + to_string(document_id));
+vector<MatchOfDocument> SearchServer::MatchDocumentsBatch(const std::string_view raw_query, const vector<int>& document_ids, bool parallel) const {
+    vector<MatchOfDocument> result;
+    result.reserve(document_ids.size());
+    //<id, индекс в result> по возрастанию id - в том же порядке, что и списки слов
+    vector<pair<int, size_t>> sorted_ids;
+    sorted_ids.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        const DocumentTable::Ordinal ordinal = documents_.Find(document_id);
+        if (ordinal == DocumentTable::NPOS) {
+            throw std::out_of_range("Передан несуществующий document_id "s + to_string(document_id));
+        }
+        sorted_ids.emplace_back(document_id, result.size());
+        result.emplace_back(vector<string_view>{}, documents_.GetStatus(ordinal));
     }
-    const auto query = ParseQueryView(raw_query);
-    if( //execution::par ,  - хуже
-        any_of(query.minus_words.begin(), query.minus_words.end(), [this, document_id](const std::string_view word) {
-            const auto it = word_to_document_freqs_.find(word);
-                if(it == word_to_document_freqs_.end()) return false;
-                if (it->second.find(document_id) == it->second.end()) return false;
-                return true;
+    sort(sorted_ids.begin(), sorted_ids.end());
+
+    const auto query_lease = ParseQueryView(raw_query);
+    auto& query = *query_lease;
+    TRACE_SCOPE("MatchDocuments", MATCH);
+    vector<const DocumentFreqs*> minus_freqs;
+    for (const auto& word : query.minus_words) {
+        if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+            minus_freqs.push_back(&it->second);
         }
-        )        
-      )  return { {}, documents_.at(document_id).status };
-        
-    vector<string_view> matched_words(query.plus_words.size());
-
-    auto& word_of_doc = doc_id_word_freq_.at(document_id);
-    vector<string_view> words;
-    words.reserve(word_of_doc.size());
-    for (auto& word: word_of_doc) words.emplace_back(word.first);
-    
-
-    auto it = copy_if(execution::par, words.begin(), words.end(), matched_words.begin(),
-            [&query](const auto& word) { //перебор слов запроса
-                if (find(query.plus_words.begin(), query.plus_words.end(), word) == query.plus_words.end())  //если слово-запрос в составе документа(document_id)
-                return false;
-                else
-                return true;
+    }
+    for (const auto& prefix : query.minus_prefixes) {
+        ForEachWordWithPrefix(prefix, 0, [&minus_freqs](string_view, const DocumentFreqs& document_freqs) {
+            minus_freqs.push_back(&document_freqs);
         });
-        matched_words.resize(distance(matched_words.begin(), it));
-
-        //отсортирован, уникален
-        sort(matched_words.begin(), matched_words.end());
-        matched_words.resize(std::distance(matched_words.begin(), std::unique(matched_words.begin(), matched_words.end())));
+    }
+    //все слова словаря, которые может вернуть MatchDocument: плюс-слова, раскрытия префиксов и слов с опечатками
+    vector<pair<string_view, const DocumentFreqs*>> plus_freqs;
+    for (const auto& word : query.plus_words) {
+        if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+            plus_freqs.emplace_back(it->first, &it->second);
+        }
+    }
+    for (const auto& prefix : query.plus_prefixes) {
+        ForEachWordWithPrefix(prefix, options_.max_prefix_expansions, [&plus_freqs](string_view word, const DocumentFreqs& document_freqs) {
+            plus_freqs.emplace_back(word, &document_freqs);
+        });
+    }
+    for (const auto& fuzzy_word : query.fuzzy_words) {
+        for (const auto& expansion : ExpandFuzzyWord(fuzzy_word)) {
+            plus_freqs.emplace_back(expansion.word, expansion.document_freqs);
+        }
+    }
+    //по алфавиту, тогда слова каждого документа добавляются уже отсортированными
+    sort(plus_freqs.begin(), plus_freqs.end());
+    plus_freqs.erase(unique(plus_freqs.begin(), plus_freqs.end()), plus_freqs.end());
+
+    //пересечение списка слова с отсортированной частью id: слиянием или поиском каждого id, что дешевле
+    auto for_each_common = [](const DocumentFreqs& document_freqs, auto first, auto last, auto function) {
+        const size_t count = static_cast<size_t>(last - first);
+        if (count * 8 < document_freqs.size()) {
+            for (; first != last; ++first) {
+                if (document_freqs.count(first->first) > 0) {
+                    function(first->second);
+                }
+            }
+            return;
+        }
+        auto it = document_freqs.lower_bound(first->first);
+        while (first != last && it != document_freqs.end()) {
+            if (it->first < first->first) {
+                ++it;
+            }
+            else if (first->first < it->first) {
+                ++first;
+            }
+            else {
+                //один id может быть передан несколько раз
+                for (const int document_id = first->first; first != last && first->first == document_id; ++first) {
+                    function(first->second);
+                }
+                ++it;
+            }
+        }
+    };
+
+    //индексы result, не совпадающие ни с чем; части пишут в разные элементы
+    vector<char> rejected(result.size());
+    auto match_chunk = [&](size_t chunk) {
+        const auto first = sorted_ids.begin() + chunk * MATCH_DOCUMENTS_CHUNK_SIZE;
+        const auto last = sorted_ids.begin() + min(sorted_ids.size(), (chunk + 1) * MATCH_DOCUMENTS_CHUNK_SIZE);
+        for (const auto* document_freqs : minus_freqs) {
+            for_each_common(*document_freqs, first, last, [&rejected](size_t index) { rejected[index] = 1; });
+        }
+        if (!query.phrases.empty()) {
+            for (auto it = first; it != last; ++it) {
+                if (!MatchesPhrases(query, it->first)) {
+                    rejected[it->second] = 1;
+                }
+            }
+        }
+        for (const auto& [word, document_freqs] : plus_freqs) {
+            for_each_common(*document_freqs, first, last, [&result, &rejected, word = word](size_t index) {
+                if (!rejected[index]) {
+                    get<0>(result[index]).push_back(word);
+                }
+            });
+        }
+    };
 
-        return make_pair(matched_words, documents_.at(document_id).status);
+    const size_t chunk_count = (sorted_ids.size() + MATCH_DOCUMENTS_CHUNK_SIZE - 1) / MATCH_DOCUMENTS_CHUNK_SIZE;
+    vector<size_t> chunks(chunk_count);
+    iota(chunks.begin(), chunks.end(), 0);
+    if (parallel) {
+        for_each(execution::par, chunks.begin(), chunks.end(), match_chunk);
+    }
+    else {
+        for_each(chunks.begin(), chunks.end(), match_chunk);
+    }
+    return result;
 }
 
 // Finish for class SearchServer
@@ -223,7 +924,7 @@ void AddDocument(SearchServer& search_server, int document_id, const std::string
 void FindTopDocuments(const SearchServer& search_server, const string& raw_query) {
     std::cout << "Результаты поиска по запросу: "s << raw_query << std::endl;
     try {
-        LOG_DURATION("Operation time");
+        TRACE_SCOPE("FindTopDocuments", REQUEST);
         for (const Document& document : search_server.FindTopDocuments(raw_query)) {
             PrintDocument(document);
         }
@@ -236,10 +937,12 @@ void FindTopDocuments(const SearchServer& search_server, const string& raw_query
 void MatchDocuments(const SearchServer& search_server, const string& query) {
     std::cout << "Матчинг документов по запросу: "s << query << std::endl;
     try {
-        LOG_DURATION("Operation time");
-        for (auto index = search_server.cbegin(); index != search_server.cend(); ++index) {
-            const auto [words, status] = search_server.MatchDocument(query, *index);
-            PrintMatchDocumentResult(*index, words, status);
+        TRACE_SCOPE("MatchDocuments", REQUEST);
+        const vector<int> document_ids(search_server.cbegin(), search_server.cend());
+        const auto matches = search_server.MatchDocuments(query, document_ids);
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto& [words, status] = matches[i];
+            PrintMatchDocumentResult(document_ids[i], words, status);
         }
     }
     catch (const exception& e) {
@@ -2,6 +2,7 @@
 #include <memory>
 #include <stdexcept>
 #include <vector>
+#include <array>
 #include <list>
 #include <set>
 #include <map>
@@ -10,56 +11,246 @@
 #include <cmath>
 #include <execution>
 #include <functional>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <utility>
 
 #include "document.h"
 #include "string_processing.h"
-#include "log_duration.h"
+#include "trace.h"
 #include "concurrent_map.h"
+#include "roaring_bitmap.h"
+#include "document_table.h"
+#include "position_list.h"
+#include "suggest_index.h"
+#include "scoring.h"
+#include "float_postings.h"
+#include "forward_index.h"
+#include "corpus_statistics.h"
+#include "counting_memory_resource.h"
 
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const int NUMBER_OF_DOCUMENTS_IN_THE_BASKET = 1000;
+//MatchDocument(par) распараллеливает поиск слов запроса в документе, начиная с такого числа плюс-слов
+const size_t MATCH_DOCUMENT_PARALLEL_THRESHOLD = 1024;
+//MatchDocuments(par) делит документы на части такого размера, части обрабатываются параллельно
+const size_t MATCH_DOCUMENTS_CHUNK_SIZE = 256;
 
 using MatchOfDocument = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
+// Способы отбора лучших документов. Передаются в FindTopDocuments на месте политики исполнения,
+// что позволяет сравнивать их на одном и том же запросе.
+namespace retrieval {
+    // MaxScore: документ-за-документом с отсечением тех, что заведомо не попадут в первые MAX_RESULT_DOCUMENT_COUNT.
+    // Верхние границы вклада слов - max(tf) списка, умноженный на idf. Результат совпадает с полным перебором.
+    struct MaxScorePolicy {};
+    inline constexpr MaxScorePolicy max_score{};
+
+    // Score-at-a-time по спискам, упорядоченным по убыванию tf: сначала обрабатываются самые весомые вхождения,
+    // обход прекращается, как только состав первых MAX_RESULT_DOCUMENT_COUNT документов больше не может измениться.
+    // postings_budget ограничивает число обработанных вхождений (0 - без ограничения, результат точный);
+    // при исчерпании бюджета выдача приближённая, но релевантности отобранных документов посчитаны точно.
+    struct ImpactOrderedPolicy {
+        size_t postings_budget = 0;
+    };
+    inline constexpr ImpactOrderedPolicy impact_ordered{};
+
+    // Накопление релевантностей в плотный массив float по порядковым номерам документов из копий списков во float32
+    // (SearchServerOptions::float_postings). Частые блоки списков складываются векторно, релевантности совпадают
+    // с точными в пределах MAX_RELEVANCE_INACCURACY. Префиксы, опечатки и ранжирование, отличное от TfIdf, -
+    // полным перебором.
+    struct FloatAccumulatePolicy {};
+    inline constexpr FloatAccumulatePolicy float_accumulate{};
+}
+
+// Фильтры документов частых видов. Передаются в FindTopDocuments вместо лямбды и распознаются по типу
+// на этапе компиляции: для каждого свой способ отбора, без вызова общего предиката (id, status, rating).
+namespace predicates {
+    // все документы: метаданные не читаются вовсе
+    struct AnyDocument {
+        bool operator()(int, DocumentStatus, int) const {
+            return true;
+        }
+    };
+
+    // документы со статусом status: пересечение с битовой картой статуса, как для DocumentStatus
+    struct StatusIs {
+        DocumentStatus status;
+
+        bool operator()(int, DocumentStatus document_status, int) const {
+            return document_status == status;
+        }
+    };
+
+    // документы с рейтингом в [min_rating, max_rating]: из таблицы читается только рейтинг
+    struct RatingBetween {
+        int min_rating;
+        int max_rating;
+
+        bool operator()(int, DocumentStatus, int rating) const {
+            return min_rating <= rating && rating <= max_rating;
+        }
+    };
+}
+
+struct SearchServerOptions {
+    // хранить позиции слов в документах: нужно для запросов-фраз "white cat" и "white cat"~N,
+    // без него фразы в запросе приводят к исключению
+    bool positional_index = false;
+    // сколько слов словаря подставляется вместо слова-префикса cat* (по алфавиту);
+    // минус-префиксы -cat* раскрываются полностью
+    size_t max_prefix_expansions = 64;
+    // нечёткий поиск кот~ / кот~2: сколько ближайших слов словаря подставляется вместо слова
+    // и во сколько раз уменьшается их вклад в релевантность за каждую правку
+    size_t max_fuzzy_expansions = 16;
+    double fuzzy_penalty = 0.5;
+    // сколько лучших слов хранит каждый узел индекса автодополнения: Suggest с k не больше этого
+    // отвечает без обхода поддерева
+    size_t suggest_cache_size = 10;
+    // хранить копии списков вхождений во float32 для retrieval::float_accumulate
+    bool float_postings = false;
+    // брать память частей индекса из собственных пулов: узлы map/set одного размера лежат рядом,
+    // выделение и освобождение не доходят до new/delete, а уничтожение индекса возвращает пулы целиком
+    bool pooled_allocation = true;
+    // хранить слова каждого документа. Без прямого индекса он не занимает памяти, но GetWordFrequencies,
+    // RemoveDocument и RemoveDuplicates обходят весь обратный индекс, а MatchDocument ищет каждое слово
+    // запроса в его списках - для индексов, которые почти не меняются
+    bool forward_index = true;
+};
+
+const int MAX_FUZZY_EDIT_DISTANCE = 2;
+
+// Память частей индекса в байтах. Берётся из счётчиков ресурсов памяти, через которые выделяют память
+// контейнеры индекса, поэтому стоит O(1); сами объекты SearchServer и контейнеров не учитываются.
+struct MemoryStats {
+    size_t dictionary = 0;        //слова словаря и стоп-слова
+    size_t inverted_index = 0;    //списки документов слов, их копии по убыванию tf, позиции и float-копии
+    size_t forward_index = 0;     //слова документов: GetWordFrequencies, MatchDocument и RemoveDocument
+    size_t document_metadata = 0; //таблица документов и битовые карты статусов
+    size_t caches = 0;            //индекс автодополнения
+    // память, взятая индексом у new/delete: при pooled_allocation включает ещё не выданный запас пулов
+    size_t system = 0;
+
+    // сумма частей, без system
+    size_t Total() const {
+        return dictionary + inverted_index + forward_index + document_metadata + caches;
+    }
+};
+
+// Результат разбора запроса без исключений
+enum class QueryParseStatus {
+    OK,
+    INVALID_CHARACTER,      //спецсимвол в тексте запроса
+    INVALID_WORD,           //пустое слово
+    INVALID_MINUS_WORD,     //"-" или "--word"
+    INVALID_PREFIX,         //"*" без префикса
+    INVALID_FUZZY_WORD,     //"-word~", "word~3", "~"
+    INVALID_PHRASE,         //ошибка после закрывающей кавычки
+    MINUS_WORD_IN_PHRASE,
+    UNCLOSED_PHRASE,
+    PHRASES_DISABLED,       //фраза без SearchServerOptions::positional_index
+};
+
 class SearchServer {
 
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
+    //счётчики памяти частей индекса (см. MemoryStats); в куче, чтобы перемещение сервера не меняло их адреса,
+    //на которые ссылаются контейнеры
+    struct IndexMemory {
+        explicit IndexMemory(bool pooled);
+
+        CountingMemoryResource system;
+        //пулы создаются только при pooled; RemoveDocument(par) освобождает списки слов из нескольких потоков
+        std::optional<std::pmr::unsynchronized_pool_resource> dictionary_pool;
+        std::optional<std::pmr::synchronized_pool_resource> inverted_index_pool;
+        std::optional<std::pmr::unsynchronized_pool_resource> forward_index_pool;
+        std::optional<std::pmr::unsynchronized_pool_resource> document_metadata_pool;
+        std::optional<std::pmr::unsynchronized_pool_resource> caches_pool;
+        CountingMemoryResource dictionary;
+        CountingMemoryResource inverted_index;
+        CountingMemoryResource forward_index;
+        CountingMemoryResource document_metadata;
+        CountingMemoryResource caches;
     };
-    std::set<std::string, std::less<>> all_words_;
-    std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_; //<word, <id, freq>>
-    std::map<int, std::map<std::string_view, double>> doc_id_word_freq_; //<id, <word, freq>> для метода GetWordFrequencies
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
+
+    using DocumentFreqs = std::pmr::map<int, double>; //<id, freq>
+    using Impacts = std::pmr::set<std::pair<double, int>, std::greater<>>; //<freq, id> по убыванию freq
+    using StatusBitmaps = std::array<RoaringBitmap, static_cast<size_t>(DocumentStatus::REMOVED) + 1>;
+
+    //объявлен первым: создаётся раньше контейнеров и разрушается после них
+    std::shared_ptr<IndexMemory> memory_;
+    std::pmr::set<std::pmr::string, std::less<>> all_words_;
+    std::pmr::set<std::pmr::string, std::less<>> stop_words_;
+    std::pmr::map<std::string_view, DocumentFreqs> word_to_document_freqs_; //<word, <id, freq>>
+    //<word, <freq, id>> те же списки, упорядоченные по убыванию freq; первый элемент - верхняя граница tf для MaxScore
+    std::pmr::map<std::string_view, Impacts> word_to_impacts_;
+    //<word, границы списка слова> для верхних оценок веса слова в MaxScore и impact-ordered
+    std::pmr::map<std::string_view, scoring::TermBounds> word_to_term_bounds_;
+    DocumentTable documents_; //метаданные документов, он же источник id для begin()/end()
+    //слова документов по порядковым номерам для GetWordFrequencies, MatchDocument и RemoveDocument,
+    //только при options_.forward_index
+    ForwardIndex forward_index_;
+    //id документов каждого статуса, индекс - static_cast<size_t>(DocumentStatus)
+    StatusBitmaps status_to_documents_;
+    //<word, <id, positions>> позиции слова в документе (с учётом стоп-слов), только при options_.positional_index
+    std::pmr::map<std::string_view, std::pmr::map<int, PositionList>> word_to_document_positions_;
+    //<word, вхождения по порядковым номерам документов> tf во float32, только при options_.float_postings
+    std::pmr::map<std::string_view, FloatPostingList> word_to_float_postings_;
+    SearchServerOptions options_;
+    SuggestIndex suggest_index_; //автодополнение по словарю, вес слова - число документов с ним
+
+    //пустой индекс, контейнеры которого выделяют память через memory
+    SearchServer(SearchServerOptions options, std::shared_ptr<IndexMemory> memory);
+
+    template <size_t... Statuses>
+    static StatusBitmaps MakeStatusBitmaps(std::pmr::memory_resource* resource, std::index_sequence<Statuses...>) {
+        return { ((void)Statuses, RoaringBitmap(resource))... };
+    }
 
 public:
-    explicit SearchServer(const std::string& stop_words_text);
-    explicit SearchServer(const std::string_view stop_words_text);
+    explicit SearchServer(const std::string& stop_words_text, SearchServerOptions options = {});
+    explicit SearchServer(const std::string_view stop_words_text, SearchServerOptions options = {});
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words)
+    explicit SearchServer(const StringContainer& stop_words, SearchServerOptions options = {})
+        : SearchServer(options, std::make_shared<IndexMemory>(options.pooled_allocation))
     {
         for (const std::string_view stop_word : stop_words) {
             if ( ! IsValidWord(stop_word)) {
                 throw std::invalid_argument("Some of stop words are invalid"s);
             }
             if (!stop_word.empty()) {
-                stop_words_.insert(std::string{ stop_word.data(), stop_word.size() });
+                stop_words_.emplace(stop_word);
             }
         }
     }
 
+    //копия индекса в собственной памяти; слова ключей указывают на строки словаря копии
+    SearchServer(const SearchServer& other);
+    //забирает индекс вместе с его памятью; other становится пустым индексом со своей памятью и теми же options
+    SearchServer(SearchServer&& other) noexcept;
+    //при pooled_allocation узлы индекса не освобождаются по одному: их память возвращают пулы
+    ~SearchServer();
+    SearchServer& operator=(const SearchServer&) = delete;
+    SearchServer& operator=(SearchServer&&) = delete;
+
     void AddDocument(int document_id, const std::string_view document, DocumentStatus status = DocumentStatus::ACTUAL, const std::vector<int>& ratings = {});
 
     size_t GetDocumentCount() const;
 
-    std::set<int>::iterator begin();
-    std::set<int>::iterator end();
-    std::set<int>::const_iterator cbegin() const;
-    std::set<int>::const_iterator cend() const;
+    //проверка запроса без исключений и (после первых запросов потока) без выделения памяти
+    QueryParseStatus ValidateQuery(const std::string_view raw_query) const;
+
+    //до k слов словаря, начинающихся с prefix, самые частые (по числу документов) первыми
+    std::vector<std::string_view> Suggest(const std::string_view prefix, size_t k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    DocumentTable::IdIterator begin() const;
+    DocumentTable::IdIterator end() const;
+    DocumentTable::IdIterator cbegin() const;
+    DocumentTable::IdIterator cend() const;
+
+    MemoryStats GetMemoryStats() const;
 
 private:
     bool IsStopWord(const std::string& word) const;
@@ -70,38 +261,291 @@ private:
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    struct PhraseWord {
+        std::string_view word;
+        uint32_t offset; //позиция слова внутри фразы, стоп-слова тоже занимают позицию
+    };
+
+    //слова фразы - phrase_words[first_word, first_word + word_count)
+    struct Phrase {
+        size_t first_word;
+        size_t word_count;
+        uint32_t slop; //сколько лишних слов допускается между словами фразы, 0 - точная фраза
+    };
+
+    //слово с опечатками: кот~ или кот~2
+    struct FuzzyWord {
+        std::string_view word;
+        int max_distance;
+    };
+
+    //слово словаря, найденное по слову с опечатками
+    struct FuzzyExpansion {
+        std::string_view word;
+        const DocumentFreqs* document_freqs;
+        int distance;
+    };
+
     struct QueryView {
-        std::vector<std::string_view> plus_words;
+        std::vector<std::string_view> plus_words; //включая слова фраз
         std::vector<std::string_view> minus_words;
+        std::vector<std::string_view> plus_prefixes; //cat* без звёздочки, отсортированы, уникальны
+        std::vector<std::string_view> minus_prefixes;
+        std::vector<FuzzyWord> fuzzy_words;
+        std::vector<PhraseWord> phrase_words;
+        std::vector<Phrase> phrases;
+    };
+
+    //буферы разбора запроса: слова запроса и сам разобранный запрос
+    struct QueryBuffers {
+        QueryView query;
+        std::vector<std::string_view> words;
+    };
+
+    //Буферы разбора, взятые из пула потока; при разрушении возвращаются в пул, их память переиспользуется
+    //следующими запросами. Вложенные разборы (в том числе задачи TBB, которые поток выполняет,
+    //пока ждёт параллельный алгоритм) получают разные буферы.
+    class QueryViewLease {
+    public:
+        QueryViewLease();
+        QueryViewLease(QueryViewLease&& other) = default;
+        QueryViewLease& operator=(QueryViewLease&&) = delete;
+        ~QueryViewLease();
+
+        QueryView& operator*() const {
+            return buffers_->query;
+        }
+        QueryView* operator->() const {
+            return &buffers_->query;
+        }
+        std::vector<std::string_view>& Words() const {
+            return buffers_->words;
+        }
+
+    private:
+        std::unique_ptr<QueryBuffers> buffers_;
     };
 
-    QueryView ParseQueryView(const std::string_view text) const;
+    static std::vector<std::unique_ptr<QueryBuffers>>& GetQueryBuffersPool();
+
+    //разбор без исключений в переданные буферы; при ошибке содержимое result не определено
+    QueryParseStatus ParseQueryView(const std::string_view text, QueryView& result, std::vector<std::string_view>& words) const;
+    //разбор в буферы потока, при ошибке - invalid_argument
+    QueryViewLease ParseQueryView(const std::string_view text) const;
+
+    //слова запроса в документе: минус-слова первыми, затем слияние отсортированных слов запроса и документа
+    MatchOfDocument MatchDocumentWords(const std::string_view raw_query, int document_id, bool parallel) const;
+
+    //MatchDocument для каждого из document_ids (порядок сохраняется) за один разбор запроса и один проход по спискам слов
+    std::vector<MatchOfDocument> MatchDocumentsBatch(const std::string_view raw_query, const std::vector<int>& document_ids, bool parallel) const;
+
+    //документ содержит все фразы запроса
+    bool MatchesPhrases(const QueryView& query, int document_id) const;
+
+    //обход слов словаря, начинающихся с prefix, по алфавиту; не больше limit слов (0 - все)
+    template <typename Function>
+    void ForEachWordWithPrefix(const std::string_view prefix, size_t limit, Function function) const {
+        size_t count = 0;
+        for (auto it = word_to_document_freqs_.lower_bound(prefix);
+             it != word_to_document_freqs_.end() && it->first.substr(0, prefix.size()) == prefix && (limit == 0 || count < limit);
+             ++it, ++count) {
+            function(it->first, it->second);
+        }
+    }
+
+    //списки слов, раскрывающих префикс, слитые в один: <id, сумма freq> по возрастанию id
+    std::vector<std::pair<int, double>> MergePrefixPostings(const std::string_view prefix) const;
+    //последнее по алфавиту слово, которым раскрывается плюс-префикс при ограничении max_prefix_expansions;
+    //пустое, если в словаре нет слов с этим префиксом
+    std::string_view GetLastPrefixExpansion(const std::string_view prefix) const;
+
+    //слова документа, раскрывающие один из плюс-префиксов prefixes, дописываются в words
+    void AppendDocumentWordsWithPrefix(const std::vector<std::string_view>& prefixes, DocumentTable::Ordinal ordinal, std::vector<std::string_view>& words) const;
+    bool HasDocumentWordWithPrefix(const std::vector<std::string_view>& prefixes, DocumentTable::Ordinal ordinal) const;
+    //слова документа по алфавиту: из прямого индекса или обходом обратного
+    std::vector<std::string_view> GetDocumentWords(int document_id, DocumentTable::Ordinal ordinal) const;
+    //найденные по словам с опечатками слова документа дописываются в words
+    void AppendDocumentFuzzyWords(const std::vector<FuzzyWord>& fuzzy_words, int document_id, std::vector<std::string_view>& words) const;
+
+    //слова словаря на расстоянии Левенштейна не больше max_distance: обход словаря по префиксам,
+    //отсекаемый автоматом Левенштейна; ближайшие и самые частые первыми, не больше options_.max_fuzzy_expansions
+    std::vector<FuzzyExpansion> ExpandFuzzyWord(const FuzzyWord& fuzzy_word) const;
+    //раскрытия всех слов с опечатками запроса по алфавиту; слово словаря, найденное по нескольким словам запроса,
+    //входит один раз с наименьшим расстоянием
+    std::vector<FuzzyExpansion> ExpandFuzzyWords(const QueryView& query) const;
+
+    //вклад слов с опечатками; совпадающие с обычными плюс-словами (отсортированы) не учитываются повторно
+    template <typename DocumentPredicate, typename Scorer, typename Function>
+    void ForEachFuzzyPosting(const QueryView& query, const DocumentPredicate& document_predicate, const Scorer& scorer, Function function) const {
+        if (query.fuzzy_words.empty()) {
+            return;
+        }
+        for (const auto& expansion : ExpandFuzzyWords(query)) {
+            if (std::binary_search(query.plus_words.begin(), query.plus_words.end(), expansion.word)) {
+                continue;
+            }
+            const double weight = ComputeInverseDocumentFreq(scorer, expansion.word, expansion.document_freqs->size())
+                * std::pow(options_.fuzzy_penalty, expansion.distance);
+            ForEachAcceptedPosting(*expansion.document_freqs, document_predicate,
+                [this, &scorer, &function, weight](int document_id, double term_freq) {
+                    function(document_id, ComputeTermWeight(scorer, document_id, term_freq) * weight);
+                });
+        }
+    }
 
     double ComputeWordInverseDocumentFreq(const std::string& word) const;
 
+    //document_freq - число документов индекса со словом; со статистикой корпуса берётся df корпуса
+    template <typename Scorer>
+    double ComputeInverseDocumentFreq(const Scorer& scorer, std::string_view word, size_t document_freq) const {
+        if constexpr (Scorer::USES_CORPUS_STATISTICS) {
+            return scorer.InverseDocumentFreq(scorer.corpus->document_count, scorer.corpus->GetWordDocumentFreq(word, document_freq));
+        }
+        else {
+            return scorer.InverseDocumentFreq(GetDocumentCount(), document_freq);
+        }
+    }
+
+    template <typename Scorer>
+    double ComputePrefixInverseDocumentFreq(const Scorer& scorer, std::string_view prefix, size_t document_freq) const {
+        if constexpr (Scorer::USES_CORPUS_STATISTICS) {
+            return scorer.InverseDocumentFreq(scorer.corpus->document_count, scorer.corpus->GetPrefixDocumentFreq(prefix, document_freq));
+        }
+        else {
+            return scorer.InverseDocumentFreq(GetDocumentCount(), document_freq);
+        }
+    }
+
+    //средняя длина документа, с которой функция ранжирования считает вес: корпуса или индекса
+    template <typename Scorer>
+    double GetAverageLength(const Scorer& scorer) const {
+        if constexpr (Scorer::USES_CORPUS_STATISTICS) {
+            return scorer.corpus->AverageLength();
+        }
+        else {
+            return documents_.AverageLength();
+        }
+    }
+
+    //вес вхождения слова в документ; длина документа достаётся из таблицы (по плотному массиву номеров),
+    //только если она нужна функции ранжирования
+    template <typename Scorer>
+    double ComputeTermWeight(const Scorer& scorer, int document_id, double term_freq) const {
+        if constexpr (Scorer::USES_DOCUMENT_LENGTH) {
+            return scorer.TermWeight(term_freq, documents_.GetLength(documents_.Find(document_id)), GetAverageLength(scorer));
+        }
+        else {
+            return scorer.TermWeight(term_freq, 0.0, 0.0);
+        }
+    }
+
+    //фильтр по статусу - проверка по битовой карте статуса, без обращения к таблице документов
+    bool IsDocumentAccepted(DocumentStatus status, int document_id) const {
+        return status_to_documents_[static_cast<size_t>(status)].Contains(document_id);
+    }
+
+    bool IsDocumentAccepted(predicates::AnyDocument, int) const {
+        return true;
+    }
+
+    bool IsDocumentAccepted(predicates::StatusIs predicate, int document_id) const {
+        return IsDocumentAccepted(predicate.status, document_id);
+    }
+
+    bool IsDocumentAccepted(predicates::RatingBetween predicate, int document_id) const {
+        const int rating = documents_.GetRating(documents_.Find(document_id));
+        return predicate.min_rating <= rating && rating <= predicate.max_rating;
+    }
+
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments([[maybe_unused]] std::execution::sequenced_policy par, const std::string_view raw_query, DocumentPredicate document_predicate) const {
-        auto query = ParseQueryView(raw_query);
+    bool IsDocumentAccepted(const DocumentPredicate& document_predicate, int document_id) const {
+        const DocumentTable::Ordinal ordinal = documents_.Find(document_id);
+        return document_predicate(document_id, documents_.GetStatus(ordinal), documents_.GetRating(ordinal));
+    }
+
+    //обход пар <id, freq> списка document_freqs, прошедших фильтр
+    template <typename Postings, typename DocumentPredicate, typename Function>
+    void ForEachAcceptedPosting(const Postings& document_freqs, const DocumentPredicate& document_predicate, Function function) const {
+        for (const auto& [document_id, term_freq] : document_freqs) {
+            if (IsDocumentAccepted(document_predicate, document_id)) {
+                function(document_id, term_freq);
+            }
+        }
+    }
+
+    template <typename Postings, typename Function>
+    void ForEachAcceptedPosting(const Postings& document_freqs, predicates::AnyDocument, Function function) const {
+        for (const auto& [document_id, term_freq] : document_freqs) {
+            function(document_id, term_freq);
+        }
+    }
+
+    template <typename Postings, typename Function>
+    void ForEachAcceptedPosting(const Postings& document_freqs, predicates::StatusIs predicate, Function function) const {
+        ForEachAcceptedPosting(document_freqs, predicate.status, function);
+    }
+
+    //для фильтра по статусу пересекаем список с битовой картой, перебирая меньшее из двух множеств
+    template <typename Postings, typename Function>
+    void ForEachAcceptedPosting(const Postings& document_freqs, DocumentStatus status, Function function) const {
+        const RoaringBitmap& status_documents = status_to_documents_[static_cast<size_t>(status)];
+        //поиск по id есть только у map, слитые списки префиксов перебираются целиком
+        if constexpr (std::is_same_v<Postings, DocumentFreqs>) {
+            if (status_documents.Cardinality() < document_freqs.size()) {
+                status_documents.ForEach([&document_freqs, &function](uint32_t document_id) {
+                    const auto it = document_freqs.find(static_cast<int>(document_id));
+                    if (it != document_freqs.end()) {
+                        function(it->first, it->second);
+                    }
+                });
+                return;
+            }
+        }
+        for (const auto& [document_id, term_freq] : document_freqs) {
+            if (status_documents.Contains(document_id)) {
+                function(document_id, term_freq);
+            }
+        }
+    }
+
+    template <typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindAllDocuments([[maybe_unused]] std::execution::sequenced_policy par, const std::string_view raw_query, DocumentPredicate document_predicate, const Scorer& scorer) const {
+        const auto query_lease = ParseQueryView(raw_query);
+        auto& query = *query_lease;
         //отсортирован, уникален
         sort(query.plus_words.begin(), query.plus_words.end());
         query.plus_words.resize(std::distance(query.plus_words.begin(), std::unique(query.plus_words.begin(), query.plus_words.end())));
 
         std::map<int, double> document_to_relevance;
         for (const auto& word : query.plus_words) {
+            TRACE_SCOPE("ScorePlusWord", SCORE);
             if (word_to_document_freqs_.count(word) == 0) {
                 continue;
             }
             auto& document_freqs = word_to_document_freqs_.find(word)->second;
-            const double inverse_document_freq = log(GetDocumentCount() * 1.0 / document_freqs.size());
-                //ComputeWordInverseDocumentFreq(word);
-            for (const auto& [document_id, term_freq] : document_freqs) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
-                }
+            const double inverse_document_freq = ComputeInverseDocumentFreq(scorer, word, document_freqs.size());
+            ForEachAcceptedPosting(document_freqs, document_predicate,
+                [this, &scorer, &document_to_relevance, inverse_document_freq](int document_id, double term_freq) {
+                    document_to_relevance[document_id] += ComputeTermWeight(scorer, document_id, term_freq) * inverse_document_freq;
+                });
+        }
+        for (const auto& prefix : query.plus_prefixes) {
+            const auto document_freqs = MergePrefixPostings(prefix);
+            TRACE_SCOPE("ScorePrefix", SCORE);
+            if (document_freqs.empty()) {
+                continue;
             }
+            const double inverse_document_freq = ComputePrefixInverseDocumentFreq(scorer, prefix, document_freqs.size());
+            ForEachAcceptedPosting(document_freqs, document_predicate,
+                [this, &scorer, &document_to_relevance, inverse_document_freq](int document_id, double term_freq) {
+                    document_to_relevance[document_id] += ComputeTermWeight(scorer, document_id, term_freq) * inverse_document_freq;
+                });
         }
+        ForEachFuzzyPosting(query, document_predicate, scorer, [&document_to_relevance](int document_id, double relevance) {
+            document_to_relevance[document_id] += relevance;
+        });
         for (const auto& word : query.minus_words) {
+            TRACE_SCOPE("ExcludeMinusWord", MINUS_FILTER);
             if (word_to_document_freqs_.count(word) == 0) {
                 continue;
             }
@@ -109,6 +553,14 @@ private:
                 document_to_relevance.erase(document_id);
             }
         }
+        for (const auto& prefix : query.minus_prefixes) {
+            TRACE_SCOPE("ExcludeMinusPrefix", MINUS_FILTER);
+            ForEachWordWithPrefix(prefix, 0, [&document_to_relevance](std::string_view, const DocumentFreqs& document_freqs) {
+                for (const auto& [document_id, _] : document_freqs) {
+                    document_to_relevance.erase(document_id);
+                }
+            });
+        }
 
         ////отсортирован, уникален
         //sort(document_to_relevance.begin(), document_to_relevance.end());
@@ -118,15 +570,19 @@ private:
 
         std::vector<Document> matched_documents;
         for (const auto& [document_id, relevance] : document_to_relevance) {
+            if (!MatchesPhrases(query, document_id)) {
+                continue;
+            }
             matched_documents.emplace_back(
-                Document{ document_id, relevance, documents_.at(document_id).rating });
+                Document{ document_id, relevance, documents_.GetRating(documents_.Find(document_id)) });
         }
         return matched_documents;
     }
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments([[maybe_unused]] std::execution::parallel_policy par, const std::string_view raw_query, DocumentPredicate document_predicate) const {
-        auto query = ParseQueryView(raw_query);
+    template <typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindAllDocuments([[maybe_unused]] std::execution::parallel_policy par, const std::string_view raw_query, DocumentPredicate document_predicate, const Scorer& scorer) const {
+        const auto query_lease = ParseQueryView(raw_query);
+        auto& query = *query_lease;
 
         //отсортирован, уникален
         sort(query.plus_words.begin(), query.plus_words.end());
@@ -134,24 +590,40 @@ private:
 
         ConcurrentMap<int, double> document_to_relevance(GetDocumentCount() / NUMBER_OF_DOCUMENTS_IN_THE_BASKET + 1);
 
-		for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(), [&document_to_relevance, document_predicate, this](const auto& word) {
+		for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(), [&document_to_relevance, document_predicate, &scorer, this](const auto& word) {
+            TRACE_SCOPE("ScorePlusWord", SCORE);
 
             if (word_to_document_freqs_.count(word) == 0) {
 				return; //этого плюс-слова в нашем сервере нет
 			}
 
             auto& document_freqs = word_to_document_freqs_.find(word)->second;
-	    	const double inverse_document_freq = log(GetDocumentCount() * 1.0 / document_freqs.size());
-
-		    for (const auto& [document_id, term_freq] : document_freqs) { //а это тоже попробуем разогнать, потом
-			    const auto& document_data = documents_.at(document_id);
-			    if (document_predicate(document_id, document_data.status, document_data.rating)) {
-				    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-			    }
-		    }
+	    	const double inverse_document_freq = ComputeInverseDocumentFreq(scorer, word, document_freqs.size());
+
+		    ForEachAcceptedPosting(document_freqs, document_predicate,
+		        [this, &scorer, &document_to_relevance, inverse_document_freq](int document_id, double term_freq) {
+				    document_to_relevance[document_id].ref_to_value += ComputeTermWeight(scorer, document_id, term_freq) * inverse_document_freq;
+		        });
 		});
 
+        for (const auto& prefix : query.plus_prefixes) {
+            const auto document_freqs = MergePrefixPostings(prefix);
+            TRACE_SCOPE("ScorePrefix", SCORE);
+            if (document_freqs.empty()) {
+                continue;
+            }
+            const double inverse_document_freq = ComputePrefixInverseDocumentFreq(scorer, prefix, document_freqs.size());
+            ForEachAcceptedPosting(document_freqs, document_predicate,
+                [this, &scorer, &document_to_relevance, inverse_document_freq](int document_id, double term_freq) {
+                    document_to_relevance[document_id].ref_to_value += ComputeTermWeight(scorer, document_id, term_freq) * inverse_document_freq;
+                });
+        }
+        ForEachFuzzyPosting(query, document_predicate, scorer, [&document_to_relevance](int document_id, double relevance) {
+            document_to_relevance[document_id].ref_to_value += relevance;
+        });
+
         for (const auto& word : query.minus_words) {
+            TRACE_SCOPE("ExcludeMinusWord", MINUS_FILTER);
             if (word_to_document_freqs_.count(word) == 0) {
                 continue;
             }
@@ -159,48 +631,405 @@ private:
                 document_to_relevance.Erase(document_id);
             }
         }
+        for (const auto& prefix : query.minus_prefixes) {
+            TRACE_SCOPE("ExcludeMinusPrefix", MINUS_FILTER);
+            ForEachWordWithPrefix(prefix, 0, [&document_to_relevance](std::string_view, const DocumentFreqs& document_freqs) {
+                for (const auto& [document_id, _] : document_freqs) {
+                    document_to_relevance.Erase(document_id);
+                }
+            });
+        }
 
         std::vector<Document> matched_documents;
         for (const auto& [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
+            if (!MatchesPhrases(query, document_id)) {
+                continue;
+            }
             matched_documents.emplace_back(
-                Document{ document_id, relevance, documents_.at(document_id).rating });
+                Document{ document_id, relevance, documents_.GetRating(documents_.Find(document_id)) });
+        }
+        return matched_documents;
+    }
+
+    template <typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindTopDocumentsMaxScore(const std::string_view raw_query, DocumentPredicate document_predicate, const Scorer& scorer) const {
+        const auto query_lease = ParseQueryView(raw_query);
+        auto& query = *query_lease;
+        //у слитых списков префиксов и раскрытий слов с опечатками нет верхних границ - такие запросы ранжируются полным перебором
+        if (!query.plus_prefixes.empty() || !query.fuzzy_words.empty()) {
+            return FindTopDocuments(std::execution::seq, raw_query, document_predicate, scorer);
+        }
+        TRACE_SCOPE("MaxScore", SCORE);
+        //отсортирован, уникален
+        sort(query.plus_words.begin(), query.plus_words.end());
+        query.plus_words.resize(std::distance(query.plus_words.begin(), std::unique(query.plus_words.begin(), query.plus_words.end())));
+
+        struct TermCursor {
+            const DocumentFreqs* document_freqs;
+            DocumentFreqs::const_iterator it;
+            double inverse_document_freq;
+            double max_score;
+        };
+        std::vector<TermCursor> terms;
+        terms.reserve(query.plus_words.size());
+        for (const auto& word : query.plus_words) {
+            const auto it = word_to_document_freqs_.find(word);
+            if (it == word_to_document_freqs_.end()) {
+                continue;
+            }
+            const double inverse_document_freq = ComputeInverseDocumentFreq(scorer, word, it->second.size());
+            terms.push_back({ &it->second, it->second.begin(), inverse_document_freq,
+                scorer.MaxTermWeight(word_to_impacts_.at(it->first).begin()->first, word_to_term_bounds_.at(it->first), GetAverageLength(scorer))
+                    * inverse_document_freq });
+        }
+        //по возрастанию верхней границы: первые слова - "необязательные", их одних не хватит для попадания в выдачу
+        sort(terms.begin(), terms.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+            return lhs.max_score < rhs.max_score;
+        });
+        std::vector<double> cumulative_max_score(terms.size());
+        double sum = 0.0;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            sum += terms[i].max_score;
+            cumulative_max_score[i] = sum;
+        }
+
+        std::vector<const DocumentFreqs*> minus_freqs;
+        for (const auto& word : query.minus_words) {
+            if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+                minus_freqs.push_back(&it->second);
+            }
+        }
+        for (const auto& prefix : query.minus_prefixes) {
+            ForEachWordWithPrefix(prefix, 0, [&minus_freqs](std::string_view, const DocumentFreqs& document_freqs) {
+                minus_freqs.push_back(&document_freqs);
+            });
+        }
+
+        //куча с худшим из отобранных документов на вершине
+        std::vector<Document> top_documents;
+        top_documents.reserve(MAX_RESULT_DOCUMENT_COUNT + 1);
+        //документ с оценкой ниже порога (с учётом погрешности сравнения релевантностей) в выдачу не попадёт
+        double threshold = -std::numeric_limits<double>::infinity();
+        size_t first_essential = 0;
+
+        while (true) {
+            int candidate = std::numeric_limits<int>::max();
+            bool has_candidate = false;
+            for (size_t i = first_essential; i < terms.size(); ++i) {
+                if (terms[i].it != terms[i].document_freqs->end() && terms[i].it->first <= candidate) {
+                    candidate = terms[i].it->first;
+                    has_candidate = true;
+                }
+            }
+            if (!has_candidate) {
+                break;
+            }
+
+            double relevance = 0.0;
+            for (size_t i = first_essential; i < terms.size(); ++i) {
+                auto& term = terms[i];
+                if (term.it != term.document_freqs->end() && term.it->first == candidate) {
+                    relevance += ComputeTermWeight(scorer, candidate, term.it->second) * term.inverse_document_freq;
+                    ++term.it;
+                }
+            }
+            if (!IsDocumentAccepted(document_predicate, candidate)
+                || any_of(minus_freqs.begin(), minus_freqs.end(), [candidate](const auto* document_freqs) {
+                       return document_freqs->count(candidate) > 0;
+                   })
+                || !MatchesPhrases(query, candidate)) {
+                continue;
+            }
+
+            bool pruned = false;
+            for (size_t i = first_essential; i-- > 0;) {
+                if (relevance + cumulative_max_score[i] < threshold) {
+                    pruned = true;
+                    break;
+                }
+                const auto& term = terms[i];
+                if (const auto it = term.document_freqs->find(candidate); it != term.document_freqs->end()) {
+                    relevance += ComputeTermWeight(scorer, candidate, it->second) * term.inverse_document_freq;
+                }
+            }
+            if (pruned) {
+                continue;
+            }
+
+            Document document{ candidate, relevance, documents_.GetRating(documents_.Find(candidate)) };
+            if (top_documents.size() == MAX_RESULT_DOCUMENT_COUNT) {
+                if (!(top_documents.front() < document)) {
+                    continue;
+                }
+                std::pop_heap(top_documents.begin(), top_documents.end(), std::greater<Document>());
+                top_documents.pop_back();
+            }
+            top_documents.push_back(document);
+            std::push_heap(top_documents.begin(), top_documents.end(), std::greater<Document>());
+
+            if (top_documents.size() == MAX_RESULT_DOCUMENT_COUNT) {
+                threshold = top_documents.front().relevance - MAX_RELEVANCE_INACCURACY;
+                while (first_essential < terms.size() && cumulative_max_score[first_essential] < threshold) {
+                    ++first_essential;
+                }
+            }
+        }
+
+        sort(top_documents.begin(), top_documents.end(), std::greater<Document>());
+        return top_documents;
+    }
+
+    template <typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindTopDocumentsImpactOrdered(retrieval::ImpactOrderedPolicy policy, const std::string_view raw_query, DocumentPredicate document_predicate, const Scorer& scorer) const {
+        const auto query_lease = ParseQueryView(raw_query);
+        auto& query = *query_lease;
+        //у слитых списков префиксов и раскрытий слов с опечатками нет упорядоченных по tf копий - такие запросы ранжируются полным перебором
+        if (!query.plus_prefixes.empty() || !query.fuzzy_words.empty()) {
+            return FindTopDocuments(std::execution::seq, raw_query, document_predicate, scorer);
+        }
+        TRACE_SCOPE("ImpactOrdered", SCORE);
+        //отсортирован, уникален
+        sort(query.plus_words.begin(), query.plus_words.end());
+        query.plus_words.resize(std::distance(query.plus_words.begin(), std::unique(query.plus_words.begin(), query.plus_words.end())));
+
+        struct TermCursor {
+            const DocumentFreqs* document_freqs;
+            const Impacts* impacts;
+            Impacts::const_iterator it;
+            double inverse_document_freq;
+            const Scorer* scorer;
+            const scoring::TermBounds* bounds;
+            double average_length;
+
+            //граница вклада следующего вхождения - верхняя граница всего, что ещё может дать это слово
+            double NextScore() const {
+                return it == impacts->end() ? 0.0 : scorer->MaxTermWeight(it->first, *bounds, average_length) * inverse_document_freq;
+            }
+        };
+        const double average_length = GetAverageLength(scorer);
+        std::vector<TermCursor> terms;
+        terms.reserve(query.plus_words.size());
+        for (const auto& word : query.plus_words) {
+            const auto it = word_to_document_freqs_.find(word);
+            if (it == word_to_document_freqs_.end()) {
+                continue;
+            }
+            const Impacts& impacts = word_to_impacts_.at(it->first);
+            terms.push_back({ &it->second, &impacts, impacts.begin(), ComputeInverseDocumentFreq(scorer, word, it->second.size()), &scorer,
+                &word_to_term_bounds_.at(it->first), average_length });
+        }
+
+        std::vector<const DocumentFreqs*> minus_freqs;
+        for (const auto& word : query.minus_words) {
+            if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+                minus_freqs.push_back(&it->second);
+            }
+        }
+        for (const auto& prefix : query.minus_prefixes) {
+            ForEachWordWithPrefix(prefix, 0, [&minus_freqs](std::string_view, const DocumentFreqs& document_freqs) {
+                minus_freqs.push_back(&document_freqs);
+            });
+        }
+
+        std::map<int, double> document_to_relevance; //частичные суммы по обработанным вхождениям
+        std::set<int> rejected_documents; //не прошли предикат или содержат минус-слово
+        std::vector<Document> ranking;
+
+        //первые MAX_RESULT_DOCUMENT_COUNT документов по частичной сумме - в начале ranking; порядок тот же, что у выдачи
+        //полным перебором: релевантность с точностью MAX_RELEVANCE_INACCURACY, затем рейтинг
+        auto select_top = [this, &document_to_relevance, &ranking]() {
+            ranking.clear();
+            for (const auto& [document_id, relevance] : document_to_relevance) {
+                ranking.push_back({ document_id, relevance, documents_.GetRating(documents_.Find(document_id)) });
+            }
+            const size_t top_count = std::min<size_t>(MAX_RESULT_DOCUMENT_COUNT, ranking.size());
+            std::partial_sort(ranking.begin(), ranking.begin() + top_count, ranking.end(), std::greater<Document>());
+            return top_count;
+        };
+
+        size_t processed = 0;
+        size_t next_check = MAX_RESULT_DOCUMENT_COUNT;
+        while (policy.postings_budget == 0 || processed < policy.postings_budget) {
+            TermCursor* best_term = nullptr;
+            double remaining = 0.0;
+            for (auto& term : terms) {
+                const double next_score = term.NextScore();
+                remaining += next_score;
+                //слова с нулевым idf тоже обходим: документы с нулевой релевантностью попадают в выдачу
+                if (term.it != term.impacts->end() && (best_term == nullptr || next_score > best_term->NextScore())) {
+                    best_term = &term;
+                }
+            }
+            if (best_term == nullptr) {
+                break;
+            }
+
+            //Хватит ли оставшегося вклада, чтобы документ за пределами первых K сравнялся с одним из первых K:
+            //при равенстве в пределах MAX_RELEVANCE_INACCURACY решает рейтинг, и такой документ может войти в выдачу.
+            //Из-за допуска K-й по порядку не обязательно наименее релевантный, поэтому граница - минимум первых K
+            if (processed >= next_check) {
+                next_check = processed + std::max<size_t>(MAX_RESULT_DOCUMENT_COUNT, document_to_relevance.size() / 4);
+                if (select_top() == MAX_RESULT_DOCUMENT_COUNT) {
+                    const auto top_end = ranking.begin() + MAX_RESULT_DOCUMENT_COUNT;
+                    const auto by_relevance = [](const Document& lhs, const Document& rhs) {
+                        return lhs.relevance < rhs.relevance;
+                    };
+                    const double top_min_relevance = std::min_element(ranking.begin(), top_end, by_relevance)->relevance;
+                    const auto it_outside = std::max_element(top_end, ranking.end(), by_relevance);
+                    const double outside_relevance = it_outside == ranking.end() ? 0.0 : it_outside->relevance;
+                    if (outside_relevance + remaining < top_min_relevance - MAX_RELEVANCE_INACCURACY) {
+                        break;
+                    }
+                }
+            }
+
+            const double term_freq = best_term->it->first;
+            const int document_id = best_term->it->second;
+            ++best_term->it;
+            ++processed;
+            if (rejected_documents.count(document_id) > 0) {
+                continue;
+            }
+            auto it_relevance = document_to_relevance.find(document_id);
+            if (it_relevance == document_to_relevance.end()) {
+                if (!IsDocumentAccepted(document_predicate, document_id)
+                    || any_of(minus_freqs.begin(), minus_freqs.end(), [document_id](const auto* document_freqs) {
+                           return document_freqs->count(document_id) > 0;
+                       })
+                    || !MatchesPhrases(query, document_id)) {
+                    rejected_documents.insert(document_id);
+                    continue;
+                }
+                it_relevance = document_to_relevance.emplace(document_id, 0.0).first;
+            }
+            it_relevance->second += ComputeTermWeight(scorer, document_id, term_freq) * best_term->inverse_document_freq;
+        }
+
+        //состав выдачи определён, релевантности досчитываем точно
+        const size_t top_count = select_top();
+        std::vector<Document> top_documents;
+        top_documents.reserve(top_count);
+        for (size_t i = 0; i < top_count; ++i) {
+            const int document_id = ranking[i].id;
+            double relevance = 0.0;
+            for (const auto& term : terms) {
+                if (const auto it = term.document_freqs->find(document_id); it != term.document_freqs->end()) {
+                    relevance += ComputeTermWeight(scorer, document_id, it->second) * term.inverse_document_freq;
+                }
+            }
+            top_documents.push_back({ document_id, relevance, ranking[i].rating });
+        }
+        sort(top_documents.begin(), top_documents.end(), std::greater<Document>());
+        return top_documents;
+    }
+
+    template <typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindTopDocumentsFloat(const std::string_view raw_query, DocumentPredicate document_predicate, const Scorer& scorer) const {
+        if (!options_.float_postings) {
+            throw std::invalid_argument("Float postings are disabled in SearchServerOptions"s);
+        }
+        const auto query_lease = ParseQueryView(raw_query);
+        auto& query = *query_lease;
+        //во float хранится только tf, веса других функций ранжирования векторно не считаются
+        constexpr bool is_tf_idf = std::is_same_v<Scorer, scoring::TfIdf> || std::is_same_v<Scorer, scoring::WithCorpusStatistics<scoring::TfIdf>>;
+        if (!is_tf_idf || !query.plus_prefixes.empty() || !query.fuzzy_words.empty()) {
+            return FindTopDocuments(std::execution::seq, raw_query, document_predicate, scorer);
+        }
+        TRACE_SCOPE("FloatAccumulate", SCORE);
+        //отсортирован, уникален
+        sort(query.plus_words.begin(), query.plus_words.end());
+        query.plus_words.resize(std::distance(query.plus_words.begin(), std::unique(query.plus_words.begin(), query.plus_words.end())));
+
+        //массив релевантностей потока общий для его запросов: обнуляются только затронутые прошлым запросом блоки
+        thread_local FloatAccumulator accumulator;
+        accumulator.Reset(documents_.Capacity());
+        for (const auto& word : query.plus_words) {
+            const auto it = word_to_float_postings_.find(word);
+            if (it == word_to_float_postings_.end()) {
+                continue;
+            }
+            it->second.AccumulateTo(static_cast<float>(ComputeInverseDocumentFreq(scorer, word, it->second.Size())), accumulator);
+        }
+        for (const auto& word : query.minus_words) {
+            if (const auto it = word_to_float_postings_.find(word); it != word_to_float_postings_.end()) {
+                it->second.ExcludeFrom(accumulator);
+            }
+        }
+        for (const auto& prefix : query.minus_prefixes) {
+            ForEachWordWithPrefix(prefix, 0, [this](std::string_view word, const DocumentFreqs&) {
+                word_to_float_postings_.at(word).ExcludeFrom(accumulator);
+            });
+        }
+
+        std::vector<Document> matched_documents;
+        accumulator.ForEachFound([this, &query, &document_predicate, &matched_documents](DocumentTable::Ordinal ordinal, float relevance) {
+            const int document_id = documents_.GetId(ordinal);
+            if (IsDocumentAccepted(document_predicate, document_id) && MatchesPhrases(query, document_id)) {
+                matched_documents.emplace_back(Document{ document_id, relevance, documents_.GetRating(ordinal) });
+            }
+        });
+        sort(matched_documents.begin(), matched_documents.end(), std::greater<Document>());
+        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
         }
         return matched_documents;
     }
 
 public:
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    //копия: сами частоты лежат в памяти индекса
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    //статистика этого индекса по словам, префиксам и раскрытиям слов с опечатками запроса - первая фаза
+    //поиска по нескольким индексам: суммы по индексам передаются в FindTopDocuments через scoring::WithCorpusStatistics
+    CorpusStatistics CollectCorpusStatistics(const std::string_view raw_query) const;
 
     MatchOfDocument MatchDocument(std::execution::sequenced_policy, const std::string_view raw_query, int document_id) const;
     MatchOfDocument MatchDocument(std::execution::parallel_policy, const std::string_view raw_query, int document_id) const;
     MatchOfDocument MatchDocument(const std::string_view raw_query, int document_id) const;
 
+    //результаты MatchDocument для всех document_ids в их порядке; запрос разбирается один раз,
+    //документы находятся пересечением списков слов запроса с отсортированными id, par - параллельно по документам
+    template <typename ExecutionPolicy, typename DocumentIds>
+    std::vector<MatchOfDocument> MatchDocuments(ExecutionPolicy, const std::string_view raw_query, const DocumentIds& document_ids) const {
+        return MatchDocumentsBatch(raw_query, std::vector<int>(std::begin(document_ids), std::end(document_ids)),
+            std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::parallel_policy>);
+    }
+
+    template <typename DocumentIds>
+    std::vector<MatchOfDocument> MatchDocuments(const std::string_view raw_query, const DocumentIds& document_ids) const {
+        return MatchDocuments(std::execution::seq, raw_query, document_ids);
+    }
+
     void RemoveDuplicates();
 
     std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
 
     std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
 
-    template <typename ExecutionPolicy, typename PredicateStatus>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, PredicateStatus predicate_status) const {
+    //scorer - функция ранжирования из scoring, например scoring::Bm25{}
+    template <typename ExecutionPolicy, typename PredicateStatus, typename Scorer = scoring::TfIdf>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, PredicateStatus predicate_status, Scorer scorer = {}) const {
         
-        std::vector < Document> matched_documents;
-
-        if constexpr (std::is_same_v<std::decay_t<PredicateStatus>, DocumentStatus>) {
-            matched_documents = FindAllDocuments(policy, raw_query, 
-                [predicate_status]([[maybe_unused]] int document_id, PredicateStatus status, [[maybe_unused]] int rating) {
-                    return predicate_status == status; }
-            );
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, retrieval::MaxScorePolicy>) {
+            return FindTopDocumentsMaxScore(raw_query, predicate_status, scorer);
+        }
+        else if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, retrieval::ImpactOrderedPolicy>) {
+            return FindTopDocumentsImpactOrdered(policy, raw_query, predicate_status, scorer);
         }
-        else{
-            matched_documents = FindAllDocuments(policy, raw_query, predicate_status);
+        else if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, retrieval::FloatAccumulatePolicy>) {
+            return FindTopDocumentsFloat(raw_query, predicate_status, scorer);
         }
+        else {
+            //DocumentStatus передаётся как есть и фильтруется по битовой карте, остальные предикаты - через таблицу документов
+            std::vector < Document> matched_documents = FindAllDocuments(policy, raw_query, predicate_status, scorer);
+            TRACE_SCOPE("SelectTop", TOP_K);
 
-        sort(matched_documents.begin(), matched_documents.end(), std::greater<Document>());
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+            sort(matched_documents.begin(), matched_documents.end(), std::greater<Document>());
+            if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+                matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+            }
+            return matched_documents;
         }
-        return matched_documents;
     }
 
     template <typename Predicate>
@@ -210,34 +1039,52 @@ public:
 
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query) const {
-        return FindTopDocuments(policy, raw_query,
-            []([[maybe_unused]] int document_id, DocumentStatus status, [[maybe_unused]] int rating) {
-                return DocumentStatus::ACTUAL == status;
-            });
+        return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
     }
 
     void RemoveDocument(int document_id);
 
     template <typename ExecutionPolicy>
     void RemoveDocument(ExecutionPolicy policy, int document_id) {
-
-        std::vector<std::string_view> words;
-        words.reserve(doc_id_word_freq_[document_id].size());
-        for_each(doc_id_word_freq_[document_id].begin(), doc_id_word_freq_[document_id].end(),
-            [&words](auto& elem) { words.emplace_back(elem.first); });
+        const DocumentTable::Ordinal ordinal = documents_.Find(document_id);
+        if (ordinal == DocumentTable::NPOS) {
+            return;
+        }
+        const std::vector<std::string_view> words = GetDocumentWords(document_id, ordinal);
 
                 for_each(policy, words.begin(), words.end(), //map<int, map<string, double>>
-                    [this, document_id](auto& word) { //map<string, double>>
-                        word_to_document_freqs_.find(word)->second.erase(document_id); //map<string, map<int, double>> 
-                        //защита от деления на ноль при вычислении freg
-                        auto it_document_freqs = word_to_document_freqs_.find(word);
-                        if (it_document_freqs->second.empty())
-                            word_to_document_freqs_.erase(it_document_freqs);
+                    [this, document_id, ordinal](auto& word) { //map<string, double>>
+                        auto& document_freqs = word_to_document_freqs_.find(word)->second; //map<string, map<int, double>> 
+                        const auto it = document_freqs.find(document_id);
+                        const double term_freq = it->second;
+                        document_freqs.erase(it);
+                        word_to_impacts_.find(word)->second.erase({ term_freq, document_id });
+                        if (const auto it_positions = word_to_document_positions_.find(word); it_positions != word_to_document_positions_.end()) {
+                            it_positions->second.erase(document_id);
+                        }
+                        if (const auto it_float = word_to_float_postings_.find(word); it_float != word_to_float_postings_.end()) {
+                            it_float->second.Erase(ordinal);
+                        }
                     }
                 );
-        documents_.erase(document_id);
-        document_ids_.erase(document_id);
-        doc_id_word_freq_.erase(document_id);
+        //защита от деления на ноль при вычислении freg
+        //пустые списки удаляются последовательно: erase из общего map небезопасен при параллельном обходе
+        for (const auto& word : words) {
+            auto it_document_freqs = word_to_document_freqs_.find(word);
+            suggest_index_.Update(word, it_document_freqs->second.size());
+            if (it_document_freqs->second.empty()) {
+                word_to_impacts_.erase(it_document_freqs->first);
+                word_to_term_bounds_.erase(it_document_freqs->first);
+                word_to_document_positions_.erase(it_document_freqs->first);
+                word_to_float_postings_.erase(it_document_freqs->first);
+                word_to_document_freqs_.erase(it_document_freqs);
+            }
+        }
+        status_to_documents_[static_cast<size_t>(documents_.GetStatus(ordinal))].Remove(document_id);
+        if (options_.forward_index) {
+            forward_index_.Clear(ordinal);
+        }
+        documents_.Remove(document_id);
     }
 };
 
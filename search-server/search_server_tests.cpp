@@ -1,9 +1,21 @@
 ﻿#include "search_server_tests.h"
 #include "search_server.h"
 #include "process_queries.h"
+#include "async_search_server.h"
+#include "request_queue.h"
+#include "generator.h"
+#include "sharded_search_server.h"
+#include "multi_process_search_server.h"
+#include "shard_service.h"
 #include "test_framework.h"
 #include <assert.h>
+#include <fstream>
+#include <iomanip>
+#include <limits>
 #include <numeric>
+#include <random>
+#include <sstream>
+#include <unistd.h>
 
 // -------- Начало модульных тестов поисковой системы ----------
 
@@ -36,7 +48,7 @@ void TestAddDocuments () {
 
     try {
         server.AddDocument(0, "белый кот и модный ошейник"s);
-        ASSERT_EQUAL_HINT(server.GetDocumentCount(), 1, "Server should contain one document"s);
+        ASSERT_EQUAL_HINT(server.GetDocumentCount(), 1u, "Server should contain one document"s);
     }  catch (...) {
         ASSERT_HINT (false, "Problems with adding correct document"s);
     }
@@ -44,7 +56,7 @@ void TestAddDocuments () {
     try {
         server.AddDocument(1, "пушистый кот пушистый хвост"s);
         server.AddDocument(2, "ухоженный пёс выразительные глаза"s);
-        ASSERT_EQUAL_HINT(server.GetDocumentCount(), 3, "Server should contain three documents"s);
+        ASSERT_EQUAL_HINT(server.GetDocumentCount(), 3u, "Server should contain three documents"s);
     }  catch (...) {
         ASSERT_HINT (false, "Problems with adding correct documents");
     }
@@ -55,7 +67,7 @@ void TestAddDocuments () {
     //}  catch (...) {}
     try {
         server.AddDocument(3, ""s);
-        ASSERT_EQUAL_HINT(server.GetDocumentCount(), 4, "Server add empty document"s);
+        ASSERT_EQUAL_HINT(server.GetDocumentCount(), 4u, "Server add empty document"s);
     }  catch (...) {
         ASSERT_HINT(false, "Problems with add empty document"s);
     }
@@ -527,6 +539,1245 @@ void TestGetWordFrequencies() {
     }
 }
 
+// Проверка фильтрации по статусу через битовые карты: результат должен совпадать с фильтрацией предикатом,
+// в том числе после удаления документов и при переходе контейнера битовой карты из массива в биты и обратно
+void TestFindedDocumentsStatusBitmap() {
+    SearchServer server("и в на"s);
+    const int document_count = 10000;
+    for (int id = 0; id < document_count; ++id) {
+        const DocumentStatus status = id % 100 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(id, id % 3 == 0 ? "пушистый кот"s : "ухоженный пёс пушистый хвост"s, status, { id % 7 });
+    }
+    for (int id = 0; id < document_count; id += 2) {
+        server.RemoveDocument(id);
+    }
+
+    for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED, DocumentStatus::IRRELEVANT }) {
+        const auto by_predicate = server.FindTopDocuments("пушистый кот"s, [status](int, DocumentStatus document_status, int) {
+            return document_status == status;
+        });
+        ASSERT_EQUAL_HINT(server.FindTopDocuments("пушистый кот"s, status), by_predicate, "Status bitmap filter differs from predicate"s);
+        ASSERT_EQUAL_HINT(server.FindTopDocuments(std::execution::par, "пушистый кот"s, status), by_predicate, "Status bitmap filter differs from predicate (par)"s);
+    }
+
+    RoaringBitmap bitmap;
+    for (uint32_t value = 0; value < 10000; ++value) {
+        bitmap.Add(value * 3);
+    }
+    bitmap.Add(1u << 20);
+    ASSERT_EQUAL(bitmap.Cardinality(), 10001u);
+    ASSERT(bitmap.Contains(29997) && !bitmap.Contains(29998) && bitmap.Contains(1u << 20));
+    for (uint32_t value = 0; value < 9990; ++value) {
+        bitmap.Remove(value * 3);
+    }
+    vector<uint32_t> values;
+    bitmap.ForEach([&values](uint32_t value) { values.push_back(value); });
+    ASSERT_EQUAL(values.size(), 11u);
+    ASSERT_EQUAL(values.front(), 29970u);
+    ASSERT_EQUAL(values.back(), 1u << 20);
+}
+
+// Проверка таблицы документов: обход id по возрастанию, переиспользование номеров, метаданные после удаления
+void TestDocumentTable() {
+    SearchServer server(""s);
+    server.AddDocument(5, "белый кот"s, DocumentStatus::ACTUAL, { 5 });
+    server.AddDocument(1, "пушистый кот"s, DocumentStatus::BANNED, { 1 });
+    server.AddDocument(3, "ухоженный пёс"s, DocumentStatus::ACTUAL, { 3 });
+    server.RemoveDocument(5);
+    server.AddDocument(4, "модный кот"s, DocumentStatus::IRRELEVANT, { 4 });
+
+    vector<int> ids(server.begin(), server.end());
+    ASSERT_EQUAL_HINT(ids, vector<int>({ 1, 3, 4 }), "Document ids must be iterated in ascending order"s);
+
+    const auto found_docs = server.FindTopDocuments("кот"s, [](int, DocumentStatus, int rating) { return rating > 0; });
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    ASSERT_EQUAL(found_docs.at(0).rating, 4);
+    ASSERT_EQUAL(found_docs.at(1).rating, 1);
+    ASSERT(get<1>(server.MatchDocument("кот"s, 4)) == DocumentStatus::IRRELEVANT);
+
+    DocumentTable table;
+    const auto first = table.Add(10, 1, DocumentStatus::ACTUAL, 4);
+    table.Add(20, 2, DocumentStatus::BANNED, 2);
+    table.Remove(10);
+    ASSERT_EQUAL_HINT(table.Add(30, 3, DocumentStatus::ACTUAL, 6), first, "Free ordinal must be reused"s);
+    ASSERT_EQUAL(table.Find(10), DocumentTable::NPOS);
+    ASSERT_EQUAL(table.GetRating(table.Find(20)), 2);
+    ASSERT_EQUAL(table.Size(), 2u);
+    ASSERT_EQUAL(table.GetLength(table.Find(30)), 6u);
+    ASSERT_EQUAL(table.AverageLength(), 4.0);
+}
+
+// Проверка MaxScore: отбор с отсечением должен давать тот же результат, что и полный перебор
+void TestFindTopDocumentsMaxScore() {
+    mt19937 generator(42);
+    vector<string> dictionary;
+    for (int i = 0; i < 50; ++i) {
+        dictionary.push_back("word"s + to_string(i));
+    }
+    // слова с меньшим номером встречаются чаще
+    auto random_word = [&generator, &dictionary]() {
+        const int index = uniform_int_distribution<int>(0, static_cast<int>(dictionary.size()) - 1)(generator);
+        return dictionary[uniform_int_distribution<int>(0, index)(generator)];
+    };
+
+    SearchServer server(""s);
+    for (int id = 0; id < 500; ++id) {
+        string text;
+        const int word_count = uniform_int_distribution<int>(1, 12)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += random_word() + " "s;
+        }
+        server.AddDocument(id, text, id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id });
+    }
+    for (int id = 0; id < 500; id += 7) {
+        server.RemoveDocument(id);
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        string query = random_word() + " "s + random_word() + " "s + random_word();
+        if (i % 4 == 0) {
+            query += " -"s + random_word();
+        }
+        ASSERT_EQUAL_HINT(server.FindTopDocuments(retrieval::max_score, query), server.FindTopDocuments(query),
+            "MaxScore result differs from exhaustive search"s);
+        ASSERT_EQUAL_HINT(server.FindTopDocuments(retrieval::max_score, query, DocumentStatus::BANNED),
+            server.FindTopDocuments(query, DocumentStatus::BANNED), "MaxScore result differs from exhaustive search"s);
+        auto odd_rating = [](int, DocumentStatus, int rating) { return rating % 2 == 1; };
+        ASSERT_EQUAL_HINT(server.FindTopDocuments(retrieval::max_score, query, odd_rating), server.FindTopDocuments(query, odd_rating),
+            "MaxScore result differs from exhaustive search"s);
+    }
+}
+
+// Проверка score-at-a-time по спискам, упорядоченным по tf: без бюджета результат точный,
+// с бюджетом - не больше MAX_RESULT_DOCUMENT_COUNT документов с точно посчитанной релевантностью
+void TestFindTopDocumentsImpactOrdered() {
+    mt19937 generator(7);
+    auto random_word = [&generator]() {
+        const int index = uniform_int_distribution<int>(0, 39)(generator);
+        return "word"s + to_string(uniform_int_distribution<int>(0, index)(generator));
+    };
+
+    SearchServer server(""s);
+    for (int id = 0; id < 500; ++id) {
+        string text;
+        const int word_count = uniform_int_distribution<int>(1, 12)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += random_word() + " "s;
+        }
+        server.AddDocument(id, text, id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id });
+    }
+    for (int id = 0; id < 500; id += 7) {
+        server.RemoveDocument(std::execution::par, id);
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        string query = random_word() + " "s + random_word() + " "s + random_word();
+        if (i % 4 == 0) {
+            query += " -"s + random_word();
+        }
+        const auto expected = server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(server.FindTopDocuments(retrieval::impact_ordered, query), expected,
+            "Impact-ordered result differs from exhaustive search"s);
+        ASSERT_EQUAL_HINT(server.FindTopDocuments(retrieval::impact_ordered, query, DocumentStatus::BANNED),
+            server.FindTopDocuments(query, DocumentStatus::BANNED), "Impact-ordered result differs from exhaustive search"s);
+
+        const auto approximate = server.FindTopDocuments(retrieval::ImpactOrderedPolicy{ 10 }, query);
+        ASSERT(approximate.size() <= expected.size());
+        for (const Document& document : approximate) {
+            const auto exact = server.FindTopDocuments(query, [&document](int document_id, DocumentStatus status, int) {
+                return document_id == document.id && status == DocumentStatus::ACTUAL;
+            });
+            ASSERT_EQUAL_HINT(exact.size(), 1u, "Approximate result contains filtered document"s);
+            ASSERT_EQUAL_HINT(exact.at(0), document, "Approximate result relevance must be exact"s);
+        }
+    }
+
+    // слово из каждого документа имеет нулевой idf: документы только с ним попадают в выдачу с нулевой релевантностью
+    SearchServer common(""s);
+    for (int id = 0; id < 20; ++id) {
+        common.AddDocument(id, id < 3 ? "common rare"s : "common word"s + to_string(id), DocumentStatus::ACTUAL, { id });
+    }
+    for (const string& query : { "common"s, "common rare"s }) {
+        const auto expected = common.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(expected.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT), query);
+        ASSERT_EQUAL_HINT(common.FindTopDocuments(retrieval::impact_ordered, query), expected, query);
+    }
+    ASSERT_EQUAL(common.FindTopDocuments(retrieval::impact_ordered, "common"s).back().relevance, 0.0);
+
+    // при равной релевантности порядок - по рейтингу, как у полного перебора; рейтинг убывает с ростом id
+    SearchServer tied(""s);
+    for (int id = 0; id < 8; ++id) {
+        tied.AddDocument(id, "cat dog"s, DocumentStatus::ACTUAL, { 100 - id });
+    }
+    tied.AddDocument(8, "bird"s, DocumentStatus::ACTUAL, { 1 });
+    const auto tied_expected = tied.FindTopDocuments("cat"s);
+    vector<int> tied_ids;
+    for (const Document& document : tied.FindTopDocuments(retrieval::ImpactOrderedPolicy{ 0 }, "cat"s)) {
+        tied_ids.push_back(document.id);
+    }
+    ASSERT_EQUAL(tied_ids, vector<int>({ 0, 1, 2, 3, 4 }));
+    ASSERT_EQUAL(tied.FindTopDocuments(retrieval::impact_ordered, "cat"s), tied_expected);
+    ASSERT_EQUAL(tied.FindTopDocuments(retrieval::impact_ordered, "cat dog"s), tied.FindTopDocuments("cat dog"s));
+}
+
+// Проверка запросов-фраз: точная фраза, фраза со стоп-словом, окно близости и ошибки разбора
+void TestPhraseQueries() {
+    SearchServer server("и в на"s, SearchServerOptions{ true });
+    server.AddDocument(0, "белый кот и модный ошейник"s);
+    server.AddDocument(1, "кот белый пушистый хвост"s);
+    server.AddDocument(2, "белый и очень пушистый кот"s);
+    server.AddDocument(3, "удаляемый белый кот"s);
+    server.RemoveDocument(3);
+
+    auto ids = [](const vector<Document>& documents) {
+        vector<int> result;
+        for (const Document& document : documents) {
+            result.push_back(document.id);
+        }
+        sort(result.begin(), result.end());
+        return result;
+    };
+
+    ASSERT_EQUAL(ids(server.FindTopDocuments("\"белый кот\""s)), vector<int>({ 0 }));
+    ASSERT_EQUAL(ids(server.FindTopDocuments(std::execution::par, "\"белый кот\""s)), vector<int>({ 0 }));
+    ASSERT_EQUAL(ids(server.FindTopDocuments(retrieval::max_score, "\"белый кот\" хвост"s)), vector<int>({ 0 }));
+    ASSERT_EQUAL(ids(server.FindTopDocuments(retrieval::impact_ordered, "\"белый кот\" хвост"s)), vector<int>({ 0 }));
+    // стоп-слово внутри фразы занимает позицию
+    ASSERT_EQUAL(ids(server.FindTopDocuments("\"кот и модный\""s)), vector<int>({ 0 }));
+    ASSERT_EQUAL(ids(server.FindTopDocuments("\"кот модный\""s)), vector<int>());
+    // окно близости: между словами допускается не больше N лишних слов, порядок важен
+    ASSERT_EQUAL(ids(server.FindTopDocuments("\"белый пушистый\"~1"s)), vector<int>({ 1 }));
+    ASSERT_EQUAL(ids(server.FindTopDocuments("\"белый пушистый\"~2"s)), vector<int>({ 1, 2 }));
+    ASSERT_EQUAL(ids(server.FindTopDocuments("\"белый кот\"~3 -ошейник"s)), vector<int>({ 2 }));
+
+    ASSERT_EQUAL(get<0>(server.MatchDocument("\"белый кот\" хвост"s, 1)), vector<string_view>());
+    ASSERT_EQUAL(get<0>(server.MatchDocument(std::execution::par, "\"белый кот\" хвост"s, 0)), vector<string_view>({ "белый"sv, "кот"sv }));
+
+    for (const string& query : { "\"белый кот"s, "\"белый кот\"~x"s, "\"белый -кот\""s }) {
+        try {
+            server.FindTopDocuments(query);
+            ASSERT_HINT(false, "Invalid phrase query must be rejected: "s + query);
+        }  catch (const invalid_argument&) {}
+    }
+    try {
+        SearchServer server_without_positions(""s);
+        server_without_positions.AddDocument(0, "белый кот"s);
+        server_without_positions.FindTopDocuments("\"белый кот\""s);
+        ASSERT_HINT(false, "Phrase query requires positional index"s);
+    }  catch (const invalid_argument&) {}
+
+    PositionList positions;
+    for (const uint32_t position : { 0u, 5u, 300u, 100000u }) {
+        positions.Append(position);
+    }
+    ASSERT_EQUAL(positions.Decode(), vector<uint32_t>({ 0, 5, 300, 100000 }));
+    ASSERT_EQUAL(positions.ByteSize(), 7u);
+}
+
+// Проверка запросов-префиксов: раскрытие по словарю, слияние списков, ограничение раскрытия, минус-префиксы
+void TestPrefixQueries() {
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s);
+    server.AddDocument(1, "пушистый котёнок пушистый длинный хвост"s);
+    server.AddDocument(2, "ухоженный пёс котофей"s);
+    server.AddDocument(3, "скворец евгений"s);
+
+    // кот* раскрывается в кот, котёнок, котофей; слитый список - 3 документа из 4
+    const auto found_docs = server.FindTopDocuments("кот*"s);
+    ASSERT_EQUAL(found_docs.size(), 3u);
+    const double idf = log(4.0 / 3.0);
+    ASSERT_EQUAL(found_docs.at(0), Document(2, idf / 3.0, 0));
+    ASSERT_EQUAL(found_docs.at(1), Document(0, idf / 4.0, 0));
+    ASSERT_EQUAL(found_docs.at(2), Document(1, idf / 5.0, 0));
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "кот*"s), found_docs);
+    ASSERT_EQUAL(server.FindTopDocuments(retrieval::max_score, "кот*"s), found_docs);
+
+    ASSERT_EQUAL(server.FindTopDocuments("пушистый -кот*"s).size(), 0u);
+    ASSERT_EQUAL(server.FindTopDocuments(retrieval::impact_ordered, "пёс евгений -кото*"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("собака*"s).size(), 0u);
+
+    ASSERT_EQUAL(get<0>(server.MatchDocument("кот* хвост"s, 1)), vector<string_view>({ "котёнок"sv, "хвост"sv }));
+    ASSERT_EQUAL(get<0>(server.MatchDocument(std::execution::par, "кот* хвост -пуш*"s, 1)), vector<string_view>());
+
+    SearchServerOptions options;
+    options.max_prefix_expansions = 1;
+    SearchServer limited_server(""s, options);
+    limited_server.AddDocument(0, "кот"s);
+    limited_server.AddDocument(1, "котёнок"s);
+    ASSERT_EQUAL_HINT(limited_server.FindTopDocuments("кот*"s).size(), 1u, "Prefix expansion must be limited"s);
+    // MatchDocument возвращает только слова, которые учитывает поиск
+    ASSERT_EQUAL(get<0>(limited_server.MatchDocument("кот*"s, 0)), vector<string_view>({ "кот"sv }));
+    ASSERT_EQUAL(get<0>(limited_server.MatchDocument("кот*"s, 1)), vector<string_view>());
+    ASSERT_EQUAL(get<0>(limited_server.MatchDocuments("кот*"s, vector<int>{ 1, 0 }).at(0)), vector<string_view>());
+    ASSERT_EQUAL(get<0>(limited_server.MatchDocuments("кот*"s, vector<int>{ 1, 0 }).at(1)), vector<string_view>({ "кот"sv }));
+
+    try {
+        server.FindTopDocuments("кот -*"s);
+        ASSERT_HINT(false, "Empty prefix must be rejected"s);
+    }  catch (const invalid_argument&) {}
+}
+
+// Проверка слов с опечатками: раскрытие по расстоянию Левенштейна, штраф за правки, ограничение раскрытия и ошибки разбора
+void TestFuzzyQueries() {
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s);
+    server.AddDocument(1, "пушистый кит"s);
+    server.AddDocument(2, "ухоженный пёс"s);
+    server.AddDocument(3, "скворец евгений"s);
+
+    // кот~ раскрывается в кот (расстояние 0) и кит (расстояние 1, штраф 0.5)
+    const auto found_docs = server.FindTopDocuments("кот~"s);
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    const double idf = log(4.0);
+    ASSERT_EQUAL(found_docs.at(0), Document(0, idf / 4.0, 0));
+    ASSERT_EQUAL(found_docs.at(1), Document(1, idf * 0.5 / 2.0, 0));
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "кот~1"s), found_docs);
+    ASSERT_EQUAL(server.FindTopDocuments(retrieval::max_score, "кот~"s), found_docs);
+
+    ASSERT_EQUAL(server.FindTopDocuments("кот~0"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("сквориц~ -евгений"s).size(), 0u);
+    ASSERT_EQUAL(server.FindTopDocuments("песик~2"s).size(), 0u);
+    ASSERT_EQUAL(server.FindTopDocuments("пёсик~2"s).size(), 1u);
+
+    ASSERT_EQUAL(get<0>(server.MatchDocument("кат~ пушистый"s, 1)), vector<string_view>({ "кит"sv, "пушистый"sv }));
+    ASSERT_EQUAL(get<0>(server.MatchDocument(std::execution::par, "кат~"s, 2)), vector<string_view>());
+
+    SearchServerOptions options;
+    options.max_fuzzy_expansions = 1;
+    SearchServer limited_server(""s, options);
+    limited_server.AddDocument(0, "кот"s);
+    limited_server.AddDocument(1, "кит"s);
+    ASSERT_EQUAL_HINT(limited_server.FindTopDocuments("кот~"s).size(), 1u, "Fuzzy expansion must be limited"s);
+
+    // два слова с опечатками, раскрывающиеся в одно слово словаря, учитывают его один раз с наименьшим расстоянием
+    ASSERT_EQUAL(server.FindTopDocuments("кот~ кат~"s), found_docs);
+    // ~ не в конце слова - часть обычного слова
+    server.AddDocument(4, "a~b"s);
+    ASSERT_EQUAL(server.FindTopDocuments("a~b"s).size(), 1u);
+    ASSERT(server.ValidateQuery("кот~x"s) == QueryParseStatus::OK);
+
+    for (const string& query : { "-кот~"s, "кот~3"s, "~"s }) {
+        try {
+            server.FindTopDocuments(query);
+            ASSERT_HINT(false, "Invalid fuzzy query must be rejected"s);
+        }  catch (const invalid_argument&) {}
+    }
+}
+
+// Проверка автодополнения: слова по убыванию числа документов, пересчёт при удалении, обход поддерева при малом кэше узла
+void TestSuggest() {
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s);
+    server.AddDocument(1, "пушистый кот пушистый хвост"s);
+    server.AddDocument(2, "ухоженный котёнок котофей"s);
+    server.AddDocument(3, "кот котёнок евгений"s);
+
+    ASSERT_EQUAL(server.Suggest("кот"s), vector<string_view>({ "кот"sv, "котёнок"sv, "котофей"sv }));
+    ASSERT_EQUAL(server.Suggest("кот"s, 2), vector<string_view>({ "кот"sv, "котёнок"sv }));
+    ASSERT_EQUAL(server.Suggest("п"s), vector<string_view>({ "пушистый"sv }));
+    ASSERT_EQUAL(server.Suggest("собака"s).size(), 0u);
+    ASSERT_EQUAL(server.Suggest(""s, 1), vector<string_view>({ "кот"sv }));
+
+    // веса пересчитываются при удалении документов
+    server.RemoveDocument(0);
+    server.RemoveDocument(1);
+    ASSERT_EQUAL(server.Suggest("кот"s), vector<string_view>({ "котёнок"sv, "кот"sv, "котофей"sv }));
+    // при равенстве - по возрастанию байтов UTF-8, "ё" после "о"
+    server.RemoveDocument(3);
+    ASSERT_EQUAL(server.Suggest("кот"s), vector<string_view>({ "котофей"sv, "котёнок"sv }));
+    ASSERT_EQUAL(server.Suggest("пуш"s).size(), 0u);
+    server.AddDocument(4, "пушистый кот"s);
+    ASSERT_EQUAL(server.Suggest("пуш"s), vector<string_view>({ "пушистый"sv }));
+
+    // список узла меньше k - слова добираются обходом поддерева
+    SearchServerOptions options;
+    options.suggest_cache_size = 1;
+    SearchServer small_cache_server(""s, options);
+    small_cache_server.AddDocument(0, "кот котёнок"s);
+    small_cache_server.AddDocument(1, "котёнок"s);
+    ASSERT_EQUAL(small_cache_server.Suggest("ко"s, 1), vector<string_view>({ "котёнок"sv }));
+    ASSERT_EQUAL(small_cache_server.Suggest("ко"s, 5), vector<string_view>({ "котёнок"sv, "кот"sv }));
+    small_cache_server.RemoveDocument(1);
+    ASSERT_EQUAL(small_cache_server.Suggest("ко"s, 1), vector<string_view>({ "кот"sv }));
+
+    try {
+        server.Suggest("ко\x12т"s);
+        ASSERT_HINT(false, "Invalid prefix must be rejected"s);
+    }  catch (const invalid_argument&) {}
+}
+
+// Проверка BM25: длинные документы штрафуются, отсечение и параллельный поиск дают тот же результат
+void TestBm25Ranking() {
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s);
+    server.AddDocument(1, "пушистый кот пушистый хвост"s);
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s);
+    server.AddDocument(3, "кот"s);
+
+    const scoring::Bm25 bm25;
+    const double average_length = (4.0 + 4.0 + 4.0 + 1.0) / 4.0;
+    auto weight = [&bm25, average_length](double count, double length) {
+        return count * (bm25.k1 + 1.0) / (count + bm25.k1 * (1.0 - bm25.b + bm25.b * length / average_length));
+    };
+    const double cat_idf = log(1.0 + (4.0 - 3.0 + 0.5) / (3.0 + 0.5));
+    const double fluffy_idf = log(1.0 + (4.0 - 1.0 + 0.5) / (1.0 + 0.5));
+
+    const auto found_docs = server.FindTopDocuments(std::execution::seq, "пушистый кот"s, DocumentStatus::ACTUAL, bm25);
+    ASSERT_EQUAL(found_docs.size(), 3u);
+    ASSERT_EQUAL(found_docs.at(0), Document(1, fluffy_idf * weight(2.0, 4.0) + cat_idf * weight(1.0, 4.0), 0));
+    ASSERT_EQUAL(found_docs.at(1), Document(3, cat_idf * weight(1.0, 1.0), 0));
+    ASSERT_EQUAL(found_docs.at(2), Document(0, cat_idf * weight(1.0, 4.0), 0));
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "пушистый кот"s, DocumentStatus::ACTUAL, bm25), found_docs);
+
+    // граница веса слова по его списку: не меньше веса вхождений, меньше предела насыщения и убывает вместе с долей слова
+    const scoring::TermBounds bounds{ 2, 4 };
+    ASSERT(bm25.MaxTermWeight(0.5, bounds, average_length) >= weight(2.0, 4.0) - 1e-12);
+    ASSERT(bm25.MaxTermWeight(0.5, bounds, average_length) < bm25.k1 + 1.0);
+    ASSERT(bm25.MaxTermWeight(0.25, bounds, average_length) < bm25.MaxTermWeight(0.5, bounds, average_length));
+
+    mt19937 generator(11);
+    auto random_word = [&generator]() {
+        const int index = uniform_int_distribution<int>(0, 29)(generator);
+        return "word"s + to_string(uniform_int_distribution<int>(0, index)(generator));
+    };
+    SearchServer random_server(""s);
+    for (int id = 0; id < 300; ++id) {
+        string text;
+        const int word_count = uniform_int_distribution<int>(1, 20)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += random_word() + " "s;
+        }
+        random_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+    }
+    for (int id = 0; id < 300; id += 9) {
+        random_server.RemoveDocument(id);
+    }
+    for (int i = 0; i < 50; ++i) {
+        const string query = random_word() + " "s + random_word() + " "s + random_word();
+        const auto expected = random_server.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL, bm25);
+        ASSERT_EQUAL(random_server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL, bm25), expected);
+        ASSERT_EQUAL_HINT(random_server.FindTopDocuments(retrieval::max_score, query, DocumentStatus::ACTUAL, bm25), expected,
+            "MaxScore result differs from exhaustive search"s);
+        ASSERT_EQUAL_HINT(random_server.FindTopDocuments(retrieval::impact_ordered, query, DocumentStatus::ACTUAL, bm25), expected,
+            "Impact-ordered result differs from exhaustive search"s);
+    }
+}
+
+// Проверка фильтров predicates: результат совпадает с эквивалентной лямбдой при любом способе отбора
+// (рейтинги различны, чтобы порядок документов с равной релевантностью был однозначен)
+void TestNamedPredicates() {
+    mt19937 generator(5);
+    auto random_word = [&generator]() {
+        return "word"s + to_string(uniform_int_distribution<int>(0, uniform_int_distribution<int>(0, 19)(generator))(generator));
+    };
+    SearchServer server(""s);
+    for (int id = 0; id < 200; ++id) {
+        string text;
+        const int word_count = uniform_int_distribution<int>(1, 10)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += random_word() + " "s;
+        }
+        server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), { id });
+    }
+
+    const auto any_lambda = [](int, DocumentStatus, int) { return true; };
+    const auto banned_lambda = [](int, DocumentStatus status, int) { return status == DocumentStatus::BANNED; };
+    const auto rating_lambda = [](int, DocumentStatus, int rating) { return 50 <= rating && rating <= 150; };
+    for (int i = 0; i < 30; ++i) {
+        const string query = random_word() + " "s + random_word() + " -"s + random_word();
+        const auto any_docs = server.FindTopDocuments(query, any_lambda);
+        ASSERT_EQUAL(server.FindTopDocuments(query, predicates::AnyDocument{}), any_docs);
+        ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, query, predicates::AnyDocument{}), any_docs);
+        ASSERT_EQUAL(server.FindTopDocuments(retrieval::max_score, query, predicates::AnyDocument{}), any_docs);
+
+        const auto banned_docs = server.FindTopDocuments(query, banned_lambda);
+        ASSERT_EQUAL(server.FindTopDocuments(query, predicates::StatusIs{ DocumentStatus::BANNED }), banned_docs);
+        ASSERT_EQUAL(server.FindTopDocuments(retrieval::impact_ordered, query, predicates::StatusIs{ DocumentStatus::BANNED }), banned_docs);
+
+        const auto rating_docs = server.FindTopDocuments(query, rating_lambda);
+        ASSERT_EQUAL(server.FindTopDocuments(query, predicates::RatingBetween{ 50, 150 }), rating_docs);
+        ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, query, predicates::RatingBetween{ 50, 150 }), rating_docs);
+    }
+}
+
+// Проверка накопления во float32: та же выдача, что и у полного перебора, в том числе после удалений
+// (частые блоки списков становятся редкими и наоборот)
+void TestFloatAccumulate() {
+    mt19937 generator(3);
+    auto random_word = [&generator]() {
+        return "word"s + to_string(uniform_int_distribution<int>(0, uniform_int_distribution<int>(0, 29)(generator))(generator));
+    };
+    SearchServerOptions options;
+    options.float_postings = true;
+    SearchServer server(""s, options);
+    for (int id = 0; id < 1500; ++id) {
+        string text;
+        const int word_count = uniform_int_distribution<int>(1, 10)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += random_word() + " "s;
+        }
+        server.AddDocument(id, text, id % 4 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id });
+    }
+    for (int id = 0; id < 1500; id += 3) {
+        server.RemoveDocument(id);
+    }
+    for (int id = 1500; id < 1600; ++id) {
+        server.AddDocument(id, random_word() + " "s + random_word(), DocumentStatus::ACTUAL, { id });
+    }
+
+    const auto odd_rating = [](int, DocumentStatus, int rating) { return rating % 2 == 1; };
+    for (int i = 0; i < 50; ++i) {
+        string query = random_word() + " "s + random_word() + " "s + random_word();
+        if (i % 3 == 0) {
+            query += " -"s + random_word();
+        }
+        ASSERT_EQUAL_HINT(server.FindTopDocuments(retrieval::float_accumulate, query), server.FindTopDocuments(query),
+            "Float accumulation result differs from exhaustive search"s);
+        ASSERT_EQUAL(server.FindTopDocuments(retrieval::float_accumulate, query, DocumentStatus::BANNED),
+            server.FindTopDocuments(query, DocumentStatus::BANNED));
+        ASSERT_EQUAL(server.FindTopDocuments(retrieval::float_accumulate, query, odd_rating),
+            server.FindTopDocuments(query, odd_rating));
+    }
+    ASSERT_EQUAL(server.FindTopDocuments(retrieval::float_accumulate, "word1 -word1*"s).size(), 0u);
+
+    try {
+        SearchServer(""s).FindTopDocuments(retrieval::float_accumulate, "word1"s);
+        ASSERT_HINT(false, "Float accumulation requires float postings"s);
+    }  catch (const invalid_argument&) {}
+}
+
+// Проверка MatchDocument на длинных запросах и документах: последовательная и параллельная версии совпадают
+void TestMatchDocumentLongQuery() {
+    SearchServer server(""s);
+    string text;
+    for (int i = 0; i < 3000; i += 2) {
+        text += "word"s + to_string(i) + " "s;
+    }
+    server.AddDocument(0, text);
+    server.AddDocument(1, "word1 word2"s);
+
+    // запрос длиннее MATCH_DOCUMENT_PARALLEL_THRESHOLD, общие слова - кратные 6
+    string query;
+    for (int i = 0; i < 3300; i += 3) {
+        query += "word"s + to_string(i) + " "s;
+    }
+    const auto seq_words = get<0>(server.MatchDocument(query, 0));
+    ASSERT_EQUAL(seq_words.size(), 500u);
+    ASSERT(is_sorted(seq_words.begin(), seq_words.end()));
+    ASSERT_EQUAL(get<0>(server.MatchDocument(std::execution::par, query, 0)), seq_words);
+    ASSERT_EQUAL(get<0>(server.MatchDocument(std::execution::par, query, 1)), vector<string_view>());
+
+    // минус-слово, которого нет в словаре, документ не отбрасывает
+    ASSERT_EQUAL(get<0>(server.MatchDocument("word2 -word7"s, 1)), vector<string_view>({ "word2"sv }));
+    ASSERT_EQUAL(get<0>(server.MatchDocument(std::execution::par, "word2 -word7"s, 1)), vector<string_view>({ "word2"sv }));
+    ASSERT_EQUAL(get<0>(server.MatchDocument(std::execution::par, query + "-word6"s, 0)), vector<string_view>());
+}
+
+// Проверка MatchDocuments: совпадает с MatchDocument для каждого документа, порядок id сохраняется
+void TestMatchDocuments() {
+    mt19937 generator(17);
+    auto random_word = [&generator]() {
+        return "word"s + to_string(uniform_int_distribution<int>(0, uniform_int_distribution<int>(0, 29)(generator))(generator));
+    };
+    SearchServerOptions options;
+    options.positional_index = true;
+    SearchServer server(""s, options);
+    for (int id = 0; id < 1000; ++id) {
+        string text;
+        const int word_count = uniform_int_distribution<int>(1, 10)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += random_word() + " "s;
+        }
+        server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), { id });
+    }
+
+    vector<int> document_ids(server.begin(), server.end());
+    shuffle(document_ids.begin(), document_ids.end(), generator);
+    document_ids.push_back(document_ids.front());
+    const vector<string> queries = { "word1 word2 word3 -word4"s, "word1* -word2*"s, "word10~ word3"s,
+        "\"word1 word2\" word5"s, "word7 word7 word8"s };
+    for (const string& query : queries) {
+        const auto seq_matches = server.MatchDocuments(query, document_ids);
+        ASSERT_EQUAL(seq_matches.size(), document_ids.size());
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            ASSERT(seq_matches[i] == server.MatchDocument(query, document_ids[i]));
+        }
+        ASSERT(server.MatchDocuments(std::execution::par, query, document_ids) == seq_matches);
+    }
+    ASSERT_EQUAL(server.MatchDocuments("word1"s, vector<int>()).size(), 0u);
+
+    try {
+        server.MatchDocuments("word1"s, vector<int>({ 1, 5000 }));
+        ASSERT_HINT(false, "Unknown document id must be rejected"s);
+    }  catch (const out_of_range&) {}
+}
+
+// Проверка разбора запроса без исключений: код ошибки соответствует исключению обычного разбора
+void TestValidateQuery() {
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s);
+
+    ASSERT(server.ValidateQuery("белый -кот кот* кот~2"s) == QueryParseStatus::OK);
+    ASSERT(server.ValidateQuery(""s) == QueryParseStatus::OK);
+    ASSERT(server.ValidateQuery("ко\x12т"s) == QueryParseStatus::INVALID_CHARACTER);
+    ASSERT(server.ValidateQuery("кот --пёс"s) == QueryParseStatus::INVALID_MINUS_WORD);
+    ASSERT(server.ValidateQuery("кот -"s) == QueryParseStatus::INVALID_MINUS_WORD);
+    ASSERT(server.ValidateQuery("кот *"s) == QueryParseStatus::INVALID_PREFIX);
+    ASSERT(server.ValidateQuery("-кот~"s) == QueryParseStatus::INVALID_FUZZY_WORD);
+    ASSERT(server.ValidateQuery("\"белый кот\""s) == QueryParseStatus::PHRASES_DISABLED);
+
+    SearchServerOptions options;
+    options.positional_index = true;
+    SearchServer phrase_server(""s, options);
+    ASSERT(phrase_server.ValidateQuery("\"белый кот\"~2"s) == QueryParseStatus::OK);
+    ASSERT(phrase_server.ValidateQuery("\"белый кот"s) == QueryParseStatus::UNCLOSED_PHRASE);
+    ASSERT(phrase_server.ValidateQuery("\"белый -кот\""s) == QueryParseStatus::MINUS_WORD_IN_PHRASE);
+    ASSERT(phrase_server.ValidateQuery("\"белый кот\"x"s) == QueryParseStatus::INVALID_PHRASE);
+
+    // буферы после ошибочного запроса переиспользуются без следов предыдущего разбора
+    ASSERT_EQUAL(server.FindTopDocuments("кот"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("пёс"s).size(), 0u);
+    try {
+        server.FindTopDocuments("кот --пёс"s);
+        ASSERT_HINT(false, "Invalid query must be rejected"s);
+    }  catch (const invalid_argument&) {}
+    ASSERT_EQUAL(server.FindTopDocuments("белый"s).size(), 1u);
+}
+
+// Проверка асинхронного входа: результаты совпадают с синхронными, при заполненной очереди запросы отклоняются
+void TestAsyncSearchServer() {
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, { 8, -3 });
+    server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::BANNED, { 5, -12, 2, 1 });
+
+    const vector<string> queries = { "пушистый кот"s, "пёс"s, "белый -кот"s, "кот ошейник"s };
+    {
+        AsyncSearchServer async_server(server, 1000, 4);
+        vector<future<vector<Document>>> results;
+        for (int i = 0; i < 25; ++i) {
+            for (const string& query : queries) {
+                auto result = async_server.SubmitFind(query);
+                ASSERT(result.has_value());
+                results.push_back(move(*result));
+            }
+        }
+        auto banned = async_server.SubmitFind("пёс"s, DocumentStatus::BANNED);
+        auto match = async_server.SubmitMatch("пушистый кот"s, 1);
+        auto missing = async_server.SubmitMatch("кот"s, 42);
+        ASSERT(banned.has_value() && match.has_value() && missing.has_value());
+        for (size_t i = 0; i < results.size(); ++i) {
+            ASSERT_EQUAL(results[i].get(), server.FindTopDocuments(queries[i % queries.size()]));
+        }
+        ASSERT_EQUAL(banned->get().size(), 1u);
+        ASSERT_EQUAL(get<0>(match->get()), vector<string_view>({ "кот"sv, "пушистый"sv }));
+        try {
+            missing->get();
+            ASSERT_HINT(false, "Request exception must be passed through future"s);
+        }  catch (const out_of_range&) {}
+        ASSERT_EQUAL(async_server.GetRejectedCount(), 0u);
+    }
+
+    // единственный поток занят, очередь на 2 запроса заполнена - третий отклоняется
+    AsyncSearchServer async_server(server, 2, 1);
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    promise<void> started;
+    auto blocker = async_server.Submit([released, &started](const SearchServer&) {
+        started.set_value();
+        released.wait();
+        return 0;
+    });
+    started.get_future().wait();
+    auto first = async_server.SubmitFind("кот"s);
+    auto second = async_server.SubmitFind("пёс"s);
+    auto rejected = async_server.SubmitFind("хвост"s);
+    ASSERT(first.has_value() && second.has_value());
+    ASSERT(!rejected.has_value());
+    ASSERT_EQUAL(async_server.GetRejectedCount(), 1u);
+    ASSERT_EQUAL(async_server.GetQueueSize(), 2u);
+    release.set_value();
+    ASSERT_EQUAL(blocker->get(), 0);
+    ASSERT_EQUAL(first->get().size(), 2u);
+    ASSERT_EQUAL(second->get().size(), 0u);
+}
+
+// Проверка статистики RequestQueue и гистограммы задержек
+void TestRequestQueueStats() {
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.Record(value);
+    }
+    const auto snapshot = histogram.Snapshot();
+    ASSERT_EQUAL(snapshot.TotalCount(), 1000u);
+    ASSERT(snapshot.ValueAtQuantile(0.5) >= 500 && snapshot.ValueAtQuantile(0.5) <= 500 + 500 / 32);
+    ASSERT(snapshot.ValueAtQuantile(1.0) >= 1000 && snapshot.ValueAtQuantile(1.0) <= 1000 + 1000 / 32);
+    ASSERT_EQUAL(snapshot.ValueAtQuantile(0.01), 10u);
+    ASSERT_EQUAL(LatencyHistogram::BucketIndex(uint64_t{ 1 } << 60), LatencyHistogram::BUCKET_COUNT - 1);
+
+    SearchServer search_server("and in at"s);
+    RequestQueue request_queue(search_server);
+    search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+    search_server.AddDocument(3, "big cat fancy collar "s, DocumentStatus::ACTUAL, { 1, 2, 8 });
+    search_server.AddDocument(4, "big dog sparrow Eugene"s, DocumentStatus::ACTUAL, { 1, 3, 2 });
+    search_server.AddDocument(5, "big dog sparrow Vasiliy"s, DocumentStatus::ACTUAL, { 1, 1, 1 });
+    // 1439 запросов с нулевым результатом, затем три непустых: первый пустой запрос вытесняется дважды
+    for (int i = 0; i < 1439; ++i) {
+        request_queue.AddFindRequest("empty request"s);
+    }
+    request_queue.AddFindRequest("curly dog"s);
+    request_queue.AddFindRequest("big collar"s);
+    request_queue.AddFindRequest("sparrow"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1437);
+
+    auto stats = request_queue.TakeWindowStats();
+    ASSERT_EQUAL(stats.request_count, 1442u);
+    ASSERT_EQUAL(stats.empty_count, 1439u);
+    ASSERT_EQUAL(stats.result_count_distribution[2], 1u);
+    ASSERT_EQUAL(stats.result_count_distribution[4], 2u);
+    ASSERT(stats.latency_p50 > 0ns && stats.latency_p50 <= stats.latency_p99 && stats.latency_p99 <= stats.latency_p999);
+    ASSERT(stats.queries_per_second > 0.0);
+
+    // потоки пишут в свои счётчики, окно содержит только новые запросы
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&request_queue] {
+            for (int i = 0; i < 500; ++i) {
+                request_queue.AddFindRequest(i % 2 == 0 ? "curly"s : "nothing"s);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    stats = request_queue.TakeWindowStats();
+    ASSERT_EQUAL(stats.request_count, 2000u);
+    ASSERT_EQUAL(stats.empty_count, 1000u);
+    ASSERT_EQUAL(stats.empty_rate, 0.5);
+    ASSERT_EQUAL(request_queue.GetStats().request_count, 3442u);
+}
+
+// Проверка трассировки: фазы считаются только при включённой записи, события выгружаются в Trace Event JSON
+void TestTracing() {
+    SearchServer search_server("and in at"s);
+    search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+    search_server.AddDocument(3, "big cat fancy collar "s, DocumentStatus::ACTUAL, { 1, 2, 8 });
+
+    trace::Reset();
+    trace::SetEnabled(false);
+    search_server.FindTopDocuments("curly -dog"s);
+    ASSERT_EQUAL(trace::GetPhaseStats()[static_cast<size_t>(trace::Phase::PARSE)].count, 0u);
+    ASSERT(trace::CollectEvents().empty());
+
+    trace::SetEnabled(true);
+    ASSERT_EQUAL(search_server.FindTopDocuments("curly -dog"s).size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "fancy col*"s).size(), 2u);
+    search_server.MatchDocument("curly cat"s, 1);
+    thread([&search_server] {
+        search_server.FindTopDocuments("cat"s);
+    }).join();
+    trace::SetEnabled(false);
+
+#if !defined(SEARCH_SERVER_DISABLE_TRACING)
+    const auto stats = trace::GetPhaseStats();
+    auto phase_count = [&stats](trace::Phase phase) {
+        return stats[static_cast<size_t>(phase)].count;
+    };
+    ASSERT_EQUAL(phase_count(trace::Phase::PARSE), 4u);
+    ASSERT_EQUAL(phase_count(trace::Phase::LOOKUP), 1u);
+    ASSERT_EQUAL(phase_count(trace::Phase::MINUS_FILTER), 1u);
+    ASSERT_EQUAL(phase_count(trace::Phase::TOP_K), 3u);
+    ASSERT_EQUAL(phase_count(trace::Phase::MATCH), 1u);
+    ASSERT(phase_count(trace::Phase::SCORE) >= 4u);
+
+    const auto events = trace::CollectEvents();
+    ASSERT(is_sorted(events.begin(), events.end(), [](const trace::Event& lhs, const trace::Event& rhs) {
+        return lhs.start_ns < rhs.start_ns;
+    }));
+    ASSERT(any_of(events.begin(), events.end(), [&events](const trace::Event& event) {
+        return event.thread_index != events.front().thread_index;
+    }));
+
+    ostringstream out;
+    trace::WriteChromeTrace(out);
+    const string json = out.str();
+    ASSERT(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[{"s) == 0);
+    ASSERT(json.find("\"name\":\"ParseQuery\",\"cat\":\"parse\",\"ph\":\"X\""s) != string::npos);
+    ASSERT(json.find("]}"s) == json.size() - 2);
+
+    //буферы завершившихся потоков: не больше MAX_EXITED_THREAD_BUFFERS до выгрузки, после выгрузки освобождаются
+    trace::Reset();
+    trace::SetEnabled(true);
+    const size_t thread_count = trace::MAX_EXITED_THREAD_BUFFERS * 2;
+    for (size_t i = 0; i < thread_count; ++i) {
+        thread([] {
+            TRACE_SCOPE("ShortLivedThread", PARSE);
+        }).join();
+    }
+    trace::SetEnabled(false);
+    auto short_lived_event_count = [] {
+        const auto events = trace::CollectEvents();
+        return count_if(events.begin(), events.end(), [](const trace::Event& event) {
+            return event.name == "ShortLivedThread"sv;
+        });
+    };
+    ASSERT_EQUAL(static_cast<size_t>(short_lived_event_count()), trace::MAX_EXITED_THREAD_BUFFERS);
+    ASSERT_EQUAL(short_lived_event_count(), 0);
+    ASSERT_EQUAL(trace::GetPhaseStats()[static_cast<size_t>(trace::Phase::PARSE)].count, thread_count);
+#endif
+    trace::Reset();
+}
+
+// Проверка генераторов нагрузки: распределение Ципфа, длины документов, минус-слова и воспроизведение журнала запросов
+void TestWorkloadGenerators() {
+    mt19937 generator(7);
+    const ZipfDistribution zipf(1000, 1.0);
+    vector<int> hits(1000);
+    for (int i = 0; i < 100000; ++i) {
+        ++hits[zipf(generator)];
+    }
+    // при exponent = 1 первое слово выпадает примерно в 10 раз чаще десятого
+    ASSERT(hits[0] > 5 * hits[9]);
+    ASSERT(hits[9] > hits[999]);
+
+    const DocumentLengthDistribution lengths(30, 0.8, 100);
+    vector<int> sampled_lengths;
+    for (int i = 0; i < 1001; ++i) {
+        sampled_lengths.push_back(lengths(generator));
+    }
+    ASSERT(all_of(sampled_lengths.begin(), sampled_lengths.end(), [](int length) { return length >= 1 && length <= 100; }));
+    nth_element(sampled_lengths.begin(), sampled_lengths.begin() + 500, sampled_lengths.end());
+    ASSERT(sampled_lengths[500] >= 25 && sampled_lengths[500] <= 35);
+
+    const vector<string> dictionary = { "cat"s, "dog"s, "tail"s };
+    for (const string& query : GenerateZipfQueries(generator, dictionary, 20, 3, 1.0, 1.0)) {
+        const auto words = SplitIntoWordsView(query);
+        ASSERT(!words.empty() && words.size() <= 3u);
+        ASSERT(all_of(words.begin(), words.end(), [](string_view word) { return word[0] == '-'; }));
+    }
+    for (const string& query : GenerateZipfQueries(generator, dictionary, 20, 3, 1.0)) {
+        ASSERT(query.find('-') == string::npos);
+    }
+
+    // строки журнала упорядочиваются по времени
+    istringstream input("0.020\tbig dog\r\n0\tcurly cat\n\n0.010\t-tail collar\n"s);
+    const auto log = ReadQueryLog(input);
+    ASSERT_EQUAL(log.size(), 3u);
+    ASSERT_EQUAL(log[0].query, "curly cat"s);
+    ASSERT_EQUAL(log[1].query, "-tail collar"s);
+    ASSERT_EQUAL(log[2].query, "big dog"s);
+    ASSERT(log[1].offset == 10ms);
+    ostringstream output;
+    WriteQueryLog(output, log);
+    istringstream written(output.str());
+    const auto reread = ReadQueryLog(written);
+    ASSERT_EQUAL(reread.size(), 3u);
+    ASSERT(reread[2].offset == log[2].offset && reread[2].query == log[2].query);
+    // наибольшее время в double: 2^63 нс, на единицу больше nanoseconds::max()
+    ostringstream max_offset;
+    max_offset << setprecision(numeric_limits<double>::max_digits10) << chrono::duration<double>(chrono::nanoseconds::max()).count() << "\tcurly\n"s;
+    for (const string& broken : { "curly cat\n"s, "abc\tcurly\n"s, "-1\tcurly\n"s, "1.5x\tcurly\n"s, "nan\tcurly\n"s, "inf\tcurly\n"s, "1e300\tcurly\n"s,
+        max_offset.str() }) {
+        istringstream broken_input(broken);
+        try {
+            ReadQueryLog(broken_input);
+            ASSERT_HINT(false, "Invalid query log line must throw"s);
+        }
+        catch (const invalid_argument&) {
+        }
+    }
+
+    // паузы 10 мс воспроизводятся в исходном порядке, ускорение сокращает их
+    vector<string> replayed;
+    auto stats = ReplayQueryLog(log, [&replayed](const string& query) { replayed.push_back(query); });
+    ASSERT_EQUAL(stats.query_count, 3u);
+    ASSERT(stats.duration >= 20ms);
+    ASSERT_EQUAL(replayed, vector<string>({ "curly cat"s, "-tail collar"s, "big dog"s }));
+    stats = ReplayQueryLog(log, [](const string&) {}, 1000.0);
+    ASSERT(stats.duration < 20ms);
+}
+
+// Проверка учёта памяти по частям индекса: рост при добавлении, уменьшение при удалении, своя память у копии и перемещённого сервера
+void TestMemoryStats() {
+    SearchServerOptions options;
+    options.positional_index = true;
+    options.float_postings = true;
+    const auto sum = [](const MemoryStats& stats) {
+        return stats.dictionary + stats.inverted_index + stats.forward_index + stats.document_metadata + stats.caches;
+    };
+
+    SearchServer server("and in"s, options);
+    const MemoryStats empty = server.GetMemoryStats();
+    ASSERT(empty.dictionary > 0); //стоп-слова
+    ASSERT_EQUAL(empty.forward_index, 0u);
+
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, { 8 });
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7 });
+    const MemoryStats two = server.GetMemoryStats();
+    ASSERT(two.dictionary > empty.dictionary);
+    ASSERT(two.inverted_index > empty.inverted_index);
+    ASSERT(two.forward_index > 0u);
+    ASSERT(two.document_metadata > empty.document_metadata);
+    ASSERT(two.caches > empty.caches);
+    ASSERT_EQUAL(two.Total(), sum(two));
+
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, { 5 });
+    const MemoryStats three = server.GetMemoryStats();
+    server.RemoveDocument(3);
+    const MemoryStats removed = server.GetMemoryStats();
+    ASSERT(removed.forward_index < three.forward_index);
+    ASSERT(removed.inverted_index < three.inverted_index);
+
+    // копия живёт в своей памяти и не ссылается на слова исходного сервера
+    auto copy = make_unique<SearchServer>(server);
+    ASSERT_EQUAL(copy->GetMemoryStats().dictionary, removed.dictionary);
+    ASSERT(copy->GetMemoryStats().forward_index > 0u);
+    static_assert(is_nothrow_move_constructible_v<SearchServer>);
+    SearchServer moved(move(*copy));
+    // перемещённый сервер пуст и выделяет память из своих счётчиков
+    const MemoryStats moved_stats = moved.GetMemoryStats();
+    ASSERT_EQUAL(copy->GetDocumentCount(), 0u);
+    ASSERT_EQUAL(copy->GetMemoryStats().inverted_index, 0u);
+    copy->AddDocument(5, "fluffy cat"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(copy->FindTopDocuments("cat"s).size(), 1u);
+    ASSERT(copy->GetMemoryStats().inverted_index > 0u);
+    ASSERT_EQUAL(moved.GetMemoryStats().inverted_index, moved_stats.inverted_index);
+    copy.reset();
+    {
+        const SearchServer source = move(server);
+    }
+    const auto documents = moved.FindTopDocuments("fluffy cat"s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    ASSERT_EQUAL(documents[0].id, 2);
+    ASSERT_EQUAL(moved.GetWordFrequencies(1).count("collar"sv), 1u);
+    ASSERT_EQUAL(moved.GetMemoryStats().Total(), sum(moved.GetMemoryStats()));
+    ASSERT(moved.GetMemoryStats().forward_index > 0u);
+    // пулы берут память у системы с запасом
+    ASSERT(moved.GetMemoryStats().system >= moved.GetMemoryStats().Total());
+
+    // без пулов части индекса выделяют память прямо у new/delete, результаты поиска те же
+    options.pooled_allocation = false;
+    SearchServer unpooled("and in"s, options);
+    unpooled.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, { 8 });
+    unpooled.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7 });
+    ASSERT_EQUAL(unpooled.GetMemoryStats().system, unpooled.GetMemoryStats().Total());
+    const auto unpooled_documents = unpooled.FindTopDocuments("fluffy cat"s);
+    ASSERT_EQUAL(unpooled_documents.size(), documents.size());
+    ASSERT_EQUAL(unpooled_documents[0].id, documents[0].id);
+    ASSERT(abs(unpooled_documents[0].relevance - documents[0].relevance) < 1e-9);
+}
+
+// Проверка индекса без прямого индекса: частоты слов, MatchDocument, удаление и дубликаты как с прямым индексом
+void TestWithoutForwardIndex() {
+    SearchServerOptions options;
+    options.positional_index = true;
+    SearchServer with_forward("and in"s, options);
+    options.forward_index = false;
+    SearchServer without_forward("and in"s, options);
+    for (SearchServer* server : { &with_forward, &without_forward }) {
+        server->AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, { 8 });
+        server->AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::BANNED, { 7 });
+        server->AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, { 5 });
+        server->AddDocument(4, "tail fluffy cat"s, DocumentStatus::ACTUAL, { 1 });
+        server->AddDocument(5, ""s, DocumentStatus::ACTUAL, { 1 });
+    }
+    ASSERT_EQUAL(without_forward.GetMemoryStats().forward_index, 0u);
+    ASSERT(without_forward.GetMemoryStats().Total() < with_forward.GetMemoryStats().Total());
+
+    // ответы без прямого индекса те же
+    ASSERT_EQUAL(without_forward.GetWordFrequencies(2), with_forward.GetWordFrequencies(2));
+    ASSERT(without_forward.GetWordFrequencies(5).empty());
+    for (const string& query : { "fluffy cat -collar"s, "fluff* white"s, "cat -tai*"s, "\"fluffy tail\" dog"s, "groomd~ eyes"s }) {
+        for (const int document_id : { 1, 2, 3, 4, 5 }) {
+            const auto [expected_words, expected_status] = with_forward.MatchDocument(query, document_id);
+            const auto [words, status] = without_forward.MatchDocument(execution::par, query, document_id);
+            ASSERT_EQUAL_HINT(words, expected_words, query);
+            ASSERT(status == expected_status);
+        }
+    }
+    try {
+        without_forward.MatchDocument("cat"s, 42);
+        ASSERT_HINT(false, "MatchDocument must throw for unknown id"s);
+    }
+    catch (const out_of_range&) {
+    }
+
+    without_forward.RemoveDocument(execution::par, 2);
+    ASSERT_EQUAL(without_forward.GetDocumentCount(), 4u);
+    ASSERT(without_forward.GetWordFrequencies(2).empty());
+    ASSERT_EQUAL(without_forward.FindTopDocuments("fluffy"s).size(), 1u);
+    //документ 4 - тот же набор слов, что у удалённого 2; пустой документ 5 остаётся
+    without_forward.AddDocument(6, "cat fluffy tail tail"s, DocumentStatus::ACTUAL, { 1 });
+    ostringstream discarded;
+    auto* const cout_buffer = cout.rdbuf(discarded.rdbuf());
+    without_forward.RemoveDuplicates();
+    cout.rdbuf(cout_buffer);
+    ASSERT_EQUAL(without_forward.GetDocumentCount(), 4u);
+    ASSERT(without_forward.GetWordFrequencies(6).empty());
+}
+
+// Проверка шардированного индекса: выдача совпадает с одним SearchServer, изменения шардов идут параллельно
+void TestShardedSearchServer() {
+    SearchServerOptions options;
+    options.positional_index = true;
+    mt19937 generator(11);
+    const auto dictionary = GenerateDictionary(generator, 60, 6);
+    const auto documents = GenerateDocuments(generator, dictionary, 300, 12, 1.0);
+    SearchServer single("and in"s, options);
+    ShardedSearchServer sharded("and in"sv, 4, options);
+    // рейтинг равен id: документы с равной релевантностью упорядочены однозначно
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        const DocumentStatus status = id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        single.AddDocument(id, documents[id], status, { id });
+        sharded.AddDocument(id, documents[id], status, { id });
+    }
+    ASSERT_EQUAL(sharded.GetShardCount(), 4u);
+    ASSERT_EQUAL(sharded.GetDocumentCount(), single.GetDocumentCount());
+
+    const auto assert_same = [](const vector<Document>& expected, const vector<Document>& documents, const string& query) {
+        ASSERT_EQUAL_HINT(documents.size(), expected.size(), query);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL_HINT(documents[i].id, expected[i].id, query);
+            ASSERT_HINT(abs(documents[i].relevance - expected[i].relevance) < 1e-9, query);
+        }
+    };
+    const vector<string> queries = {
+        dictionary[0] + " "s + dictionary[1],
+        dictionary[2] + " "s + dictionary[3] + " -"s + dictionary[0],
+        dictionary[4].substr(0, 2) + "* "s + dictionary[5],
+        "\""s + dictionary[0] + " "s + dictionary[1] + "\"~3"s,
+        dictionary[6] + "~ "s + dictionary[7],
+    };
+    for (const string& query : queries) {
+        assert_same(single.FindTopDocuments(query), sharded.FindTopDocuments(query), query);
+        assert_same(single.FindTopDocuments(execution::par, query, DocumentStatus::BANNED, scoring::Bm25{}),
+            sharded.FindTopDocuments(execution::par, query, DocumentStatus::BANNED, scoring::Bm25{}), query);
+        assert_same(single.FindTopDocuments(retrieval::max_score, query, DocumentStatus::ACTUAL),
+            sharded.FindTopDocuments(retrieval::max_score, query, DocumentStatus::ACTUAL), query);
+        assert_same(single.FindTopDocuments(retrieval::impact_ordered, query, DocumentStatus::ACTUAL, scoring::Bm25{}),
+            sharded.FindTopDocuments(retrieval::impact_ordered, query, DocumentStatus::ACTUAL, scoring::Bm25{}), query);
+        const auto even = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+        assert_same(single.FindTopDocuments(query, even), sharded.FindTopDocuments(query, even), query);
+    }
+    ASSERT_EQUAL(sharded.GetWordFrequencies(42), single.GetWordFrequencies(42));
+    ASSERT(get<0>(sharded.MatchDocument(queries[0], 1)) == get<0>(single.MatchDocument(queries[0], 1)));
+
+    // документ живёт только в своём шарде, повторный id отвергается
+    try {
+        sharded.AddDocument(42, "dog"s, DocumentStatus::ACTUAL, {});
+        ASSERT_HINT(false, "Duplicate id must throw"s);
+    }
+    catch (const invalid_argument&) {
+    }
+    try {
+        sharded.FindTopDocuments("cat --dog"s);
+        ASSERT_HINT(false, "Invalid query must throw"s);
+    }
+    catch (const invalid_argument&) {
+    }
+    for (int id = 0; id < static_cast<int>(documents.size()); id += 3) {
+        single.RemoveDocument(id);
+        sharded.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(sharded.GetDocumentCount(), single.GetDocumentCount());
+    for (const string& query : queries) {
+        assert_same(single.FindTopDocuments(query), sharded.FindTopDocuments(query), query);
+    }
+
+    // изменения разных шардов идут параллельно с поиском
+    ShardedSearchServer concurrent(""sv, 3);
+    vector<thread> writers;
+    for (int writer = 0; writer < 4; ++writer) {
+        writers.emplace_back([&concurrent, &documents, writer] {
+            for (int id = writer; id < static_cast<int>(documents.size()); id += 4) {
+                concurrent.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1 });
+                concurrent.FindTopDocuments(documents[id]);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    ASSERT_EQUAL(concurrent.GetDocumentCount(), documents.size());
+}
+
+// Проверка шардов в отдельных процессах: выдача совпадает с одним SearchServer, ошибки передаются тем же типом,
+// перезапуск шарда обнаруживается, повреждённые сообщения и чужие файлы по пути сокета отвергаются
+void TestMultiProcessSearchServer() {
+    mt19937 generator(13);
+    const auto dictionary = GenerateDictionary(generator, 60, 6);
+    const auto documents = GenerateDocuments(generator, dictionary, 200, 12, 1.0);
+    vector<string> socket_paths;
+    vector<unique_ptr<ShardProcess>> processes;
+    for (int i = 0; i < 3; ++i) {
+        socket_paths.push_back("/tmp/search-shard-"s + to_string(getpid()) + "-"s + to_string(i) + ".sock"s);
+        processes.push_back(make_unique<ShardProcess>(SEARCH_SHARD_EXECUTABLE, socket_paths.back(), "and in"s));
+    }
+    MultiProcessSearchServer remote(socket_paths);
+    SearchServer single("and in"s);
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        const DocumentStatus status = id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        single.AddDocument(id, documents[id], status, { id, -id / 2 });
+        remote.AddDocument(id, documents[id], status, { id, -id / 2 });
+    }
+    ASSERT_EQUAL(remote.GetShardCount(), 3u);
+    ASSERT_EQUAL(remote.GetDocumentCount(), single.GetDocumentCount());
+
+    const auto assert_same = [](const vector<Document>& expected, const vector<Document>& documents, const string& query) {
+        ASSERT_EQUAL_HINT(documents.size(), expected.size(), query);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL_HINT(documents[i].id, expected[i].id, query);
+            ASSERT_EQUAL_HINT(documents[i].rating, expected[i].rating, query);
+            ASSERT_HINT(abs(documents[i].relevance - expected[i].relevance) < 1e-9, query);
+        }
+    };
+    const vector<string> queries = {
+        dictionary[0] + " "s + dictionary[1],
+        dictionary[2] + " "s + dictionary[3] + " -"s + dictionary[0],
+        dictionary[4].substr(0, 2) + "* "s + dictionary[5],
+        dictionary[6] + "~ "s + dictionary[7],
+    };
+    const scoring::Bm25 bm25{ 1.6, 0.5 };
+    for (const string& query : queries) {
+        assert_same(single.FindTopDocuments(query), remote.FindTopDocuments(query), query);
+        assert_same(single.FindTopDocuments(execution::seq, query, DocumentStatus::BANNED, bm25),
+            remote.FindTopDocuments(query, DocumentStatus::BANNED, bm25), query);
+    }
+
+    // ошибки шарда приходят тем же типом исключения
+    try {
+        remote.AddDocument(42, "dog"s, DocumentStatus::ACTUAL, {});
+        ASSERT_HINT(false, "Duplicate id must throw"s);
+    }
+    catch (const invalid_argument&) {
+    }
+    try {
+        remote.FindTopDocuments("cat --dog"s);
+        ASSERT_HINT(false, "Invalid query must throw"s);
+    }
+    catch (const invalid_argument&) {
+    }
+    for (int id = 0; id < static_cast<int>(documents.size()); id += 3) {
+        single.RemoveDocument(id);
+        remote.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(remote.GetDocumentCount(), single.GetDocumentCount());
+    assert_same(single.FindTopDocuments(queries[0]), remote.FindTopDocuments(queries[0]), queries[0]);
+
+    // перезапущенный шард пуст: координатор замечает новое поколение шарда и не отвечает без его документов,
+    // пока перезапуск не принят
+    processes[1]->Restart();
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        try {
+            remote.GetDocumentCount();
+            ASSERT_HINT(false, "Request to a restarted shard must throw"s);
+        }
+        catch (const runtime_error&) {
+        }
+    }
+    try {
+        remote.FindTopDocuments(queries[0]);
+        ASSERT_HINT(false, "Search must not silently skip a restarted shard"s);
+    }
+    catch (const runtime_error&) {
+    }
+    remote.AcceptShardRestart(1);
+    size_t lost = 0;
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        lost += id % 3 != 0 && remote.GetShardIndex(id) == 1 ? 1 : 0;
+    }
+    ASSERT(lost > 0);
+    ASSERT_EQUAL(remote.GetDocumentCount(), single.GetDocumentCount() - lost);
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        if (id % 3 != 0 && remote.GetShardIndex(id) == 1) {
+            const DocumentStatus status = id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            remote.AddDocument(id, documents[id], status, { id, -id / 2 });
+        }
+    }
+    for (const string& query : queries) {
+        assert_same(single.FindTopDocuments(query), remote.FindTopDocuments(query), query);
+    }
+
+    remote.Shutdown();
+    try {
+        remote.GetDocumentCount();
+        ASSERT_HINT(false, "Request after shutdown must throw"s);
+    }
+    catch (const runtime_error&) {
+    }
+
+    // параметры индекса передаются процессу шарда командной строкой
+    ShardArguments shard_arguments{ "/tmp/shard.sock"s, "and in"s, {} };
+    shard_arguments.options.positional_index = true;
+    shard_arguments.options.max_fuzzy_expansions = 3;
+    shard_arguments.options.fuzzy_penalty = 0.1;
+    shard_arguments.options.forward_index = false;
+    const vector<string> argument_strings = MakeShardArguments(shard_arguments);
+    const ShardArguments parsed = ParseShardArguments(vector<string_view>(argument_strings.begin(), argument_strings.end()));
+    ASSERT_EQUAL(parsed.socket_path, shard_arguments.socket_path);
+    ASSERT_EQUAL(parsed.stop_words_text, shard_arguments.stop_words_text);
+    ASSERT(parsed.options.positional_index && !parsed.options.forward_index && parsed.options.pooled_allocation);
+    ASSERT_EQUAL(parsed.options.max_fuzzy_expansions, 3u);
+    ASSERT_EQUAL(parsed.options.max_prefix_expansions, SearchServerOptions{}.max_prefix_expansions);
+    ASSERT_EQUAL(parsed.options.fuzzy_penalty, 0.1);
+    for (const vector<string_view>& invalid : { vector{ "--stop-words"sv, "in"sv }, vector{ "--socket"sv },
+        vector{ "--socket"sv, "a.sock"sv, "--fuzzy-penalty"sv, "x"sv }, vector{ "--socket"sv, "a.sock"sv, "--verbose"sv } }) {
+        try {
+            ParseShardArguments(invalid);
+            ASSERT_HINT(false, "Invalid shard arguments must throw"s);
+        }
+        catch (const invalid_argument&) {
+        }
+    }
+    try {
+        ShardProcess missing("/nonexistent/search_shard"s, "/tmp/search-shard-missing.sock"s, ""s);
+        ASSERT_HINT(false, "Missing shard executable must throw"s);
+    }
+    catch (const runtime_error&) {
+    }
+
+    // файл по пути сокета, который не сокет, не удаляется
+    const string regular_file = "/tmp/search-shard-"s + to_string(getpid()) + "-file"s;
+    ofstream(regular_file) << "data"s;
+    try {
+        ServeShard(regular_file, ""sv);
+        ASSERT_HINT(false, "Shard must not replace a regular file"s);
+    }
+    catch (const runtime_error&) {
+    }
+    ASSERT(ifstream(regular_file).good());
+    unlink(regular_file.c_str());
+
+    // повреждённые сообщения - runtime_error, а не ошибка аргумента; число элементов проверяется до выделения памяти
+    shard_protocol::Writer huge_count;
+    huge_count.Write(UINT32_MAX);
+    shard_protocol::Reader huge_count_reader(huge_count.GetBuffer());
+    try {
+        shard_protocol::ReadDocuments(huge_count_reader);
+        ASSERT_HINT(false, "Document count beyond the message must throw"s);
+    }
+    catch (const runtime_error&) {
+    }
+    shard_protocol::Writer truncated;
+    truncated.Write(shard_protocol::Request::ADD_DOCUMENT);
+    truncated.Write(int32_t{ 1 });
+    bool shutdown = false;
+    SearchServer shard_server(""s);
+    const string truncated_response_data = HandleShardRequest(shard_server, 1, truncated.GetBuffer(), shutdown);
+    shard_protocol::Reader truncated_response(truncated_response_data);
+    try {
+        shard_protocol::ThrowIfError(truncated_response);
+        ASSERT_HINT(false, "Truncated request must fail"s);
+    }
+    catch (const invalid_argument&) {
+        ASSERT_HINT(false, "Truncated request is not an invalid argument"s);
+    }
+    catch (const runtime_error&) {
+    }
+}
+
 // Проверка удаления дубликатов
 void TestRemoveDuplicates() {
  // добавить тесты !!!
@@ -630,9 +1881,31 @@ void TestSearchServer() {
     RUN_TEST(TestComputeAverageRating);
     RUN_TEST(TestFindedDocumentsPredicate);
     RUN_TEST(TestFindedDocumentsStatus);
+    RUN_TEST(TestFindedDocumentsStatusBitmap);
     RUN_TEST(TestFindedDocumentsMinus);
     RUN_TEST(TestFindedDocumentsRelevance);
+    RUN_TEST(TestFindTopDocumentsMaxScore);
+    RUN_TEST(TestFindTopDocumentsImpactOrdered);
+    RUN_TEST(TestPhraseQueries);
+    RUN_TEST(TestPrefixQueries);
+    RUN_TEST(TestFuzzyQueries);
+    RUN_TEST(TestSuggest);
+    RUN_TEST(TestBm25Ranking);
+    RUN_TEST(TestNamedPredicates);
+    RUN_TEST(TestFloatAccumulate);
+    RUN_TEST(TestMatchDocumentLongQuery);
+    RUN_TEST(TestMatchDocuments);
+    RUN_TEST(TestValidateQuery);
+    RUN_TEST(TestAsyncSearchServer);
+    RUN_TEST(TestRequestQueueStats);
+    RUN_TEST(TestTracing);
+    RUN_TEST(TestWorkloadGenerators);
+    RUN_TEST(TestMemoryStats);
+    RUN_TEST(TestWithoutForwardIndex);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestMultiProcessSearchServer);
     RUN_TEST(TestGetWordFrequencies);
+    RUN_TEST(TestDocumentTable);
     RUN_TEST(TestRemoveDuplicates);
 }
 // --------- Окончание модульных тестов поисковой системы -----------
@@ -0,0 +1,4 @@
+#pragma once
+
+// модульные тесты поисковой системы; при ошибке печатают её место в cerr и вызывают abort
+void TestSearchServer();
@@ -0,0 +1,24 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "shard_service.h"
+
+using namespace std::literals;
+
+// Процесс шарда для MultiProcessSearchServer:
+//   search_shard --socket /tmp/shard-0.sock [--stop-words "and in"] [--positional-index]
+// Остальные параметры индекса - в shard_service.h. Работает до запроса SHUTDOWN от координатора или до сигнала.
+int main(int argc, char* argv[]) {
+    try {
+        const ShardArguments shard = ParseShardArguments(std::vector<std::string_view>(argv + 1, argv + argc));
+        ServeShard(shard.socket_path, shard.stop_words_text, shard.options);
+    } catch (const std::exception& e) {
+        std::cerr << "search_shard: "s << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+#include "shard_protocol.h"
+
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace shard_protocol {
+    namespace {
+        //int32 id, double relevance, int32 rating
+        const size_t DOCUMENT_SIZE = sizeof(int32_t) + sizeof(double) + sizeof(int32_t);
+
+        template <typename Map>
+        void WriteDocumentFreqs(Writer& writer, const Map& document_freqs) {
+            writer.Write(static_cast<uint32_t>(document_freqs.size()));
+            for (const auto& [term, document_freq] : document_freqs) {
+                writer.WriteString(term);
+                writer.Write(static_cast<uint64_t>(document_freq));
+            }
+        }
+
+        template <typename Map>
+        void ReadDocumentFreqs(Reader& reader, Map& document_freqs) {
+            //строка и uint64
+            const uint32_t count = reader.ReadCount(sizeof(uint32_t) + sizeof(uint64_t));
+            for (uint32_t i = 0; i < count; ++i) {
+                const string_view term = reader.ReadString();
+                document_freqs.emplace(term, static_cast<size_t>(reader.Read<uint64_t>()));
+            }
+        }
+
+        //true - все size байт прочитаны, false - соединение закрыто до первого байта
+        bool ReadExactly(int fd, char* data, size_t size) {
+            size_t done = 0;
+            while (done < size) {
+                const ssize_t received = recv(fd, data + done, size - done, 0);
+                if (received == 0 && done == 0) {
+                    return false;
+                }
+                if (received == 0) {
+                    throw runtime_error("Shard connection closed in the middle of a frame"s);
+                }
+                if (received < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw runtime_error("Shard connection read failed"s);
+                }
+                done += static_cast<size_t>(received);
+            }
+            return true;
+        }
+    }
+
+    void Writer::WriteString(string_view text) {
+        Write(static_cast<uint32_t>(text.size()));
+        buffer_.append(text.data(), text.size());
+    }
+
+    Reader::Reader(string_view data)
+        : data_(data) {
+    }
+
+    string_view Reader::ReadString() {
+        const uint32_t size = Read<uint32_t>();
+        Require(size);
+        const string_view text = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return text;
+    }
+
+    uint32_t Reader::ReadCount(size_t min_element_size) {
+        const uint32_t count = Read<uint32_t>();
+        if (count > data_.size() / min_element_size) {
+            throw runtime_error("Shard message element count exceeds its size"s);
+        }
+        return count;
+    }
+
+    void Reader::Require(size_t size) const {
+        if (data_.size() < size) {
+            throw runtime_error("Truncated shard message"s);
+        }
+    }
+
+    void WriteDocuments(Writer& writer, const vector<Document>& documents) {
+        writer.Write(static_cast<uint32_t>(documents.size()));
+        for (const Document& document : documents) {
+            writer.Write(static_cast<int32_t>(document.id));
+            writer.Write(document.relevance);
+            writer.Write(static_cast<int32_t>(document.rating));
+        }
+    }
+
+    vector<Document> ReadDocuments(Reader& reader) {
+        const uint32_t count = reader.ReadCount(DOCUMENT_SIZE);
+        vector<Document> documents;
+        documents.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            const int id = reader.Read<int32_t>();
+            const double relevance = reader.Read<double>();
+            const int rating = reader.Read<int32_t>();
+            documents.emplace_back(id, relevance, rating);
+        }
+        return documents;
+    }
+
+    void WriteCorpusStatistics(Writer& writer, const CorpusStatistics& statistics) {
+        writer.Write(static_cast<uint64_t>(statistics.document_count));
+        writer.Write(statistics.total_length);
+        WriteDocumentFreqs(writer, statistics.word_document_freqs);
+        WriteDocumentFreqs(writer, statistics.prefix_document_freqs);
+    }
+
+    CorpusStatistics ReadCorpusStatistics(Reader& reader) {
+        CorpusStatistics statistics;
+        statistics.document_count = static_cast<size_t>(reader.Read<uint64_t>());
+        statistics.total_length = reader.Read<uint64_t>();
+        ReadDocumentFreqs(reader, statistics.word_document_freqs);
+        ReadDocumentFreqs(reader, statistics.prefix_document_freqs);
+        return statistics;
+    }
+
+    void WriteScorer(Writer& writer, const scoring::TfIdf&) {
+        writer.Write(ScorerKind::TF_IDF);
+    }
+
+    void WriteScorer(Writer& writer, const scoring::Bm25& scorer) {
+        writer.Write(ScorerKind::BM25);
+        writer.Write(scorer.k1);
+        writer.Write(scorer.b);
+    }
+
+    string MakeErrorResponse(Status status, string_view message) {
+        Writer writer;
+        writer.Write(status);
+        writer.WriteString(message);
+        return writer.GetBuffer();
+    }
+
+    void ThrowIfError(Reader& reader) {
+        const Status status = reader.Read<Status>();
+        if (status == Status::OK) {
+            return;
+        }
+        const string message(reader.ReadString());
+        switch (status) {
+        case Status::INVALID_ARGUMENT:
+            throw invalid_argument(message);
+        case Status::OUT_OF_RANGE:
+            throw out_of_range(message);
+        default:
+            throw runtime_error(message);
+        }
+    }
+
+    sockaddr_un MakeSocketAddress(const string& socket_path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+            throw invalid_argument("Invalid shard socket path: "s + socket_path);
+        }
+        socket_path.copy(address.sun_path, socket_path.size());
+        return address;
+    }
+
+    void WriteFrame(int fd, string_view payload) {
+        if (payload.size() > MAX_FRAME_SIZE) {
+            throw runtime_error("Shard message is too large"s);
+        }
+        Writer header;
+        header.Write(static_cast<uint32_t>(payload.size()));
+        string frame = header.GetBuffer();
+        frame.append(payload.data(), payload.size());
+        size_t done = 0;
+        while (done < frame.size()) {
+            //MSG_NOSIGNAL: закрытое соединение - ошибка записи, а не SIGPIPE для всего процесса
+            const ssize_t sent = send(fd, frame.data() + done, frame.size() - done, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw runtime_error("Shard connection write failed"s);
+            }
+            done += static_cast<size_t>(sent);
+        }
+    }
+
+    bool ReadFrame(int fd, string& payload) {
+        char header[sizeof(uint32_t)];
+        if (!ReadExactly(fd, header, sizeof(header))) {
+            return false;
+        }
+        const uint32_t size = Reader(string_view(header, sizeof(header))).Read<uint32_t>();
+        if (size > MAX_FRAME_SIZE) {
+            throw runtime_error("Shard message is too large"s);
+        }
+        payload.resize(size);
+        if (size > 0 && !ReadExactly(fd, payload.data(), size)) {
+            throw runtime_error("Shard connection closed in the middle of a frame"s);
+        }
+        return true;
+    }
+}
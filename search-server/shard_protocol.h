@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/un.h>
+#include <type_traits>
+#include <vector>
+
+#include "corpus_statistics.h"
+#include "document.h"
+#include "scoring.h"
+
+// Двоичный протокол между координатором и процессами шардов на одной машине.
+// Сообщение - кадр: uint32 длина и тело. Числа пишутся как в памяти (порядок байт машины),
+// строки - uint32 длина и байты. Тело запроса начинается с Request, тело ответа - с Status;
+// при ошибке за Status идёт текст исключения, и клиент выбрасывает исключение того же типа.
+namespace shard_protocol {
+    enum class Request : uint8_t {
+        ADD_DOCUMENT = 1,       //int32 id, uint8 status, uint32 число оценок, int32 оценки, строка текста
+        REMOVE_DOCUMENT,        //int32 id
+        GET_DOCUMENT_COUNT,     //-> uint64
+        COLLECT_STATISTICS,     //строка запроса -> CorpusStatistics
+        FIND_TOP_DOCUMENTS,     //строка запроса, uint8 status, функция ранжирования, CorpusStatistics -> документы
+        SHUTDOWN,               //процесс шарда завершается после ответа
+        HELLO,                  //-> uint64 поколение: случайное число, новое при каждом запуске процесса шарда
+    };
+
+    enum class Status : uint8_t {
+        OK,
+        INVALID_ARGUMENT,
+        OUT_OF_RANGE,
+        ERROR,
+    };
+
+    enum class ScorerKind : uint8_t {
+        TF_IDF,
+        BM25,   //double k1, double b
+    };
+
+    // кадры больше этого считаются повреждёнными: runtime_error при чтении и записи
+    const uint32_t MAX_FRAME_SIZE = 64u << 20;
+
+    class Writer {
+    public:
+        template <typename T>
+        void Write(T value) {
+            static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            buffer_.append(bytes, sizeof(T));
+        }
+        void WriteString(std::string_view text);
+
+        const std::string& GetBuffer() const {
+            return buffer_;
+        }
+
+    private:
+        std::string buffer_;
+    };
+
+    // при нехватке байт выбрасывает runtime_error: повреждённое сообщение - ошибка связи, а не аргумента
+    class Reader {
+    public:
+        explicit Reader(std::string_view data);
+
+        template <typename T>
+        T Read() {
+            static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+            Require(sizeof(T));
+            T value;
+            std::memcpy(&value, data_.data(), sizeof(T));
+            data_.remove_prefix(sizeof(T));
+            return value;
+        }
+        // строка указывает в буфер, переданный в конструктор
+        std::string_view ReadString();
+        // uint32 число элементов, каждый не короче min_element_size байт; число больше помещающегося
+        // в остаток сообщения - runtime_error до выделения памяти под элементы
+        uint32_t ReadCount(size_t min_element_size);
+
+        bool AtEnd() const {
+            return data_.empty();
+        }
+
+    private:
+        void Require(size_t size) const;
+
+        std::string_view data_;
+    };
+
+    // 16 байт на документ: int32 id, double relevance, int32 rating
+    void WriteDocuments(Writer& writer, const std::vector<Document>& documents);
+    std::vector<Document> ReadDocuments(Reader& reader);
+
+    void WriteCorpusStatistics(Writer& writer, const CorpusStatistics& statistics);
+    CorpusStatistics ReadCorpusStatistics(Reader& reader);
+
+    void WriteScorer(Writer& writer, const scoring::TfIdf& scorer);
+    void WriteScorer(Writer& writer, const scoring::Bm25& scorer);
+
+    // ответ с ошибкой; тип исключения восстанавливает ThrowIfError
+    std::string MakeErrorResponse(Status status, std::string_view message);
+    // читает Status ответа и при ошибке выбрасывает исключение с текстом из ответа
+    void ThrowIfError(Reader& reader);
+
+    // адрес Unix domain socket; путь длиннее sun_path - invalid_argument
+    sockaddr_un MakeSocketAddress(const std::string& socket_path);
+
+    // сокеты: при ошибке ввода-вывода выбрасывают runtime_error
+    void WriteFrame(int fd, std::string_view payload);
+    // false, если соединение закрыто до начала кадра
+    bool ReadFrame(int fd, std::string& payload);
+}
@@ -0,0 +1,360 @@
+#include "shard_service.h"
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shard_protocol.h"
+
+using namespace std;
+using namespace shard_protocol;
+
+namespace {
+    DocumentStatus ReadDocumentStatus(Reader& reader) {
+        const uint8_t status = reader.Read<uint8_t>();
+        if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+            throw runtime_error("Unknown document status"s);
+        }
+        return static_cast<DocumentStatus>(status);
+    }
+
+    template <typename Scorer>
+    vector<Document> FindTopDocuments(const SearchServer& server, string_view raw_query, DocumentStatus status, const Scorer& scorer, const CorpusStatistics& corpus) {
+        return server.FindTopDocuments(execution::seq, raw_query, status, scoring::WithCorpusStatistics<Scorer>(scorer, corpus));
+    }
+
+    string HandleRequest(SearchServer& server, uint64_t generation, Reader& reader, bool& shutdown) {
+        Writer response;
+        response.Write(Status::OK);
+        switch (reader.Read<Request>()) {
+        case Request::ADD_DOCUMENT: {
+            const int document_id = reader.Read<int32_t>();
+            const DocumentStatus status = ReadDocumentStatus(reader);
+            vector<int> ratings(reader.ReadCount(sizeof(int32_t)));
+            for (int& rating : ratings) {
+                rating = reader.Read<int32_t>();
+            }
+            const string_view document = reader.ReadString();
+            server.AddDocument(document_id, document, status, ratings);
+            break;
+        }
+        case Request::REMOVE_DOCUMENT:
+            server.RemoveDocument(reader.Read<int32_t>());
+            break;
+        case Request::GET_DOCUMENT_COUNT:
+            response.Write(static_cast<uint64_t>(server.GetDocumentCount()));
+            break;
+        case Request::COLLECT_STATISTICS:
+            WriteCorpusStatistics(response, server.CollectCorpusStatistics(reader.ReadString()));
+            break;
+        case Request::FIND_TOP_DOCUMENTS: {
+            const string_view raw_query = reader.ReadString();
+            const DocumentStatus status = ReadDocumentStatus(reader);
+            const ScorerKind scorer_kind = reader.Read<ScorerKind>();
+            scoring::Bm25 bm25;
+            if (scorer_kind == ScorerKind::BM25) {
+                bm25.k1 = reader.Read<double>();
+                bm25.b = reader.Read<double>();
+            }
+            else if (scorer_kind != ScorerKind::TF_IDF) {
+                throw runtime_error("Unknown scorer"s);
+            }
+            const CorpusStatistics corpus = ReadCorpusStatistics(reader);
+            WriteDocuments(response, scorer_kind == ScorerKind::BM25
+                ? FindTopDocuments(server, raw_query, status, bm25, corpus)
+                : FindTopDocuments(server, raw_query, status, scoring::TfIdf{}, corpus));
+            break;
+        }
+        case Request::SHUTDOWN:
+            shutdown = true;
+            break;
+        case Request::HELLO:
+            response.Write(generation);
+            break;
+        default:
+            throw runtime_error("Unknown shard request"s);
+        }
+        return response.GetBuffer();
+    }
+
+    //удаляет файл сокета, оставшийся от прежнего процесса шарда; false, если по пути лежит не сокет - такой файл не трогается
+    bool RemoveSocketFile(const string& socket_path) {
+        struct stat status;
+        if (lstat(socket_path.c_str(), &status) < 0) {
+            return true;
+        }
+        if (!S_ISSOCK(status.st_mode)) {
+            return false;
+        }
+        unlink(socket_path.c_str());
+        return true;
+    }
+
+    template <typename Number>
+    Number ParseNumber(string_view argument, string_view value) {
+        Number number{};
+        const auto [end, error] = from_chars(value.data(), value.data() + value.size(), number);
+        if (error != errc() || end != value.data() + value.size()) {
+            throw invalid_argument("Invalid value for "s + string(argument));
+        }
+        return number;
+    }
+
+    //поколение процесса шарда: совпадение у двух запусков практически исключено
+    uint64_t MakeGeneration() {
+        random_device device;
+        const uint64_t time = static_cast<uint64_t>(chrono::system_clock::now().time_since_epoch().count());
+        return (static_cast<uint64_t>(device()) << 32 | device()) ^ time ^ static_cast<uint64_t>(getpid());
+    }
+
+    string FormatNumber(double number) {
+        //кратчайшая запись, которая читается обратно в то же число
+        char buffer[32];
+        const auto [end, error] = to_chars(buffer, buffer + sizeof(buffer), number);
+        return string(buffer, end);
+    }
+
+    //закрывает дескриптор при выходе из области видимости
+    class FileDescriptor {
+    public:
+        explicit FileDescriptor(int fd) : fd_(fd) {}
+        ~FileDescriptor() {
+            if (fd_ >= 0) {
+                close(fd_);
+            }
+        }
+        FileDescriptor(const FileDescriptor&) = delete;
+        FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+        int Get() const {
+            return fd_;
+        }
+
+    private:
+        int fd_;
+    };
+}
+
+string HandleShardRequest(SearchServer& server, uint64_t generation, string_view request, bool& shutdown) {
+    try {
+        Reader reader(request);
+        return HandleRequest(server, generation, reader, shutdown);
+    }
+    catch (const invalid_argument& e) {
+        return MakeErrorResponse(Status::INVALID_ARGUMENT, e.what());
+    }
+    catch (const out_of_range& e) {
+        return MakeErrorResponse(Status::OUT_OF_RANGE, e.what());
+    }
+    catch (const exception& e) {
+        return MakeErrorResponse(Status::ERROR, e.what());
+    }
+}
+
+void ServeShard(const string& socket_path, string_view stop_words_text, SearchServerOptions options) {
+    const sockaddr_un address = MakeSocketAddress(socket_path);
+    SearchServer server(stop_words_text, options);
+    const uint64_t generation = MakeGeneration();
+    const FileDescriptor listener(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (listener.Get() < 0) {
+        throw runtime_error("Cannot create shard socket"s);
+    }
+    if (!RemoveSocketFile(socket_path)) {
+        throw runtime_error("Shard socket path "s + socket_path + " is taken by a file that is not a socket"s);
+    }
+    if (bind(listener.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        || listen(listener.Get(), 16) < 0) {
+        throw runtime_error("Cannot listen on shard socket "s + socket_path);
+    }
+
+    bool shutdown = false;
+    string request;
+    while (!shutdown) {
+        const FileDescriptor connection(accept4(listener.Get(), nullptr, nullptr, SOCK_CLOEXEC));
+        if (connection.Get() < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw runtime_error("Cannot accept shard connection"s);
+        }
+        //обрыв соединения завершает только его: координатор переподключится
+        try {
+            while (!shutdown && ReadFrame(connection.Get(), request)) {
+                WriteFrame(connection.Get(), HandleShardRequest(server, generation, request, shutdown));
+            }
+        }
+        catch (const exception& e) {
+            cerr << "Shard connection dropped: "s << e.what() << endl;
+        }
+    }
+    RemoveSocketFile(socket_path);
+}
+
+vector<string> MakeShardArguments(const ShardArguments& shard) {
+    const SearchServerOptions defaults;
+    const SearchServerOptions& options = shard.options;
+    vector<string> arguments = { "--socket"s, shard.socket_path };
+    if (!shard.stop_words_text.empty()) {
+        arguments.insert(arguments.end(), { "--stop-words"s, shard.stop_words_text });
+    }
+    if (options.positional_index) {
+        arguments.push_back("--positional-index"s);
+    }
+    if (options.max_prefix_expansions != defaults.max_prefix_expansions) {
+        arguments.insert(arguments.end(), { "--max-prefix-expansions"s, to_string(options.max_prefix_expansions) });
+    }
+    if (options.max_fuzzy_expansions != defaults.max_fuzzy_expansions) {
+        arguments.insert(arguments.end(), { "--max-fuzzy-expansions"s, to_string(options.max_fuzzy_expansions) });
+    }
+    if (options.fuzzy_penalty != defaults.fuzzy_penalty) {
+        arguments.insert(arguments.end(), { "--fuzzy-penalty"s, FormatNumber(options.fuzzy_penalty) });
+    }
+    if (options.suggest_cache_size != defaults.suggest_cache_size) {
+        arguments.insert(arguments.end(), { "--suggest-cache-size"s, to_string(options.suggest_cache_size) });
+    }
+    if (options.float_postings) {
+        arguments.push_back("--float-postings"s);
+    }
+    if (!options.pooled_allocation) {
+        arguments.push_back("--no-pooled-allocation"s);
+    }
+    if (!options.forward_index) {
+        arguments.push_back("--no-forward-index"s);
+    }
+    return arguments;
+}
+
+ShardArguments ParseShardArguments(const vector<string_view>& arguments) {
+    ShardArguments shard;
+    SearchServerOptions& options = shard.options;
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        const string_view argument = arguments[i];
+        if (argument == "--positional-index"sv) {
+            options.positional_index = true;
+            continue;
+        }
+        if (argument == "--float-postings"sv) {
+            options.float_postings = true;
+            continue;
+        }
+        if (argument == "--no-pooled-allocation"sv) {
+            options.pooled_allocation = false;
+            continue;
+        }
+        if (argument == "--no-forward-index"sv) {
+            options.forward_index = false;
+            continue;
+        }
+        if (i + 1 >= arguments.size()) {
+            throw invalid_argument("Missing value for "s + string(argument));
+        }
+        const string_view value = arguments[++i];
+        if (argument == "--socket"sv) {
+            shard.socket_path = value;
+        } else if (argument == "--stop-words"sv) {
+            shard.stop_words_text = value;
+        } else if (argument == "--max-prefix-expansions"sv) {
+            options.max_prefix_expansions = ParseNumber<size_t>(argument, value);
+        } else if (argument == "--max-fuzzy-expansions"sv) {
+            options.max_fuzzy_expansions = ParseNumber<size_t>(argument, value);
+        } else if (argument == "--fuzzy-penalty"sv) {
+            options.fuzzy_penalty = ParseNumber<double>(argument, value);
+        } else if (argument == "--suggest-cache-size"sv) {
+            options.suggest_cache_size = ParseNumber<size_t>(argument, value);
+        } else {
+            throw invalid_argument("Unknown option "s + string(argument));
+        }
+    }
+    if (shard.socket_path.empty()) {
+        throw invalid_argument("--socket is required"s);
+    }
+    return shard;
+}
+
+ShardProcess::ShardProcess(string shard_executable, string socket_path, string stop_words_text, SearchServerOptions options)
+    : shard_executable_(move(shard_executable))
+    , arguments_{ move(socket_path), move(stop_words_text), options } {
+    MakeSocketAddress(arguments_.socket_path);
+    Start();
+}
+
+ShardProcess::~ShardProcess() {
+    Stop();
+}
+
+void ShardProcess::Stop() {
+    if (pid_ < 0) {
+        return;
+    }
+    kill(pid_, SIGTERM);
+    while (waitpid(pid_, nullptr, 0) < 0 && errno == EINTR) {
+    }
+    pid_ = -1;
+    //SIGTERM завершает шард без его собственной уборки
+    RemoveSocketFile(arguments_.socket_path);
+}
+
+void ShardProcess::Restart() {
+    Stop();
+    Start();
+}
+
+pid_t ShardProcess::GetPid() const {
+    return pid_;
+}
+
+const string& ShardProcess::GetSocketPath() const {
+    return arguments_.socket_path;
+}
+
+void ShardProcess::Start() {
+    //всё, что нужно дочернему процессу, готовится до fork: между fork и execv многопоточной программы
+    //допустимы только async-signal-safe вызовы
+    vector<string> arguments = MakeShardArguments(arguments_);
+    arguments.insert(arguments.begin(), shard_executable_);
+    vector<char*> argv;
+    for (string& argument : arguments) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    //канал закрывается при успешном execv; при ошибке дочерний процесс пишет в него errno
+    int exec_error_pipe[2];
+    if (pipe2(exec_error_pipe, O_CLOEXEC) < 0) {
+        throw runtime_error("Cannot start shard process"s);
+    }
+    const FileDescriptor exec_error_reader(exec_error_pipe[0]);
+    const pid_t pid = fork();
+    if (pid < 0) {
+        close(exec_error_pipe[1]);
+        throw runtime_error("Cannot start shard process"s);
+    }
+    if (pid == 0) {
+        execv(argv[0], argv.data());
+        const int error = errno;
+        [[maybe_unused]] const ssize_t written = write(exec_error_pipe[1], &error, sizeof(error));
+        _exit(127);
+    }
+    close(exec_error_pipe[1]);
+
+    int exec_error = 0;
+    ssize_t received;
+    while ((received = read(exec_error_reader.Get(), &exec_error, sizeof(exec_error))) < 0 && errno == EINTR) {
+    }
+    if (received > 0) {
+        while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+        throw runtime_error("Cannot run shard executable "s + shard_executable_ + ": "s + strerror(exec_error));
+    }
+    pid_ = pid;
+}
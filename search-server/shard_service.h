@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+#include "search_server.h"
+
+// Сторона шарда в многопроцессном режиме: SearchServer в отдельном процессе отвечает на запросы
+// координатора (MultiProcessSearchServer) по Unix domain socket, протокол - в shard_protocol.h.
+
+// выполняет запрос протокола над server и возвращает ответ; исключения сервера становятся ответами с ошибкой.
+// generation - ответ на HELLO, shutdown выставляется в true запросом SHUTDOWN
+std::string HandleShardRequest(SearchServer& server, uint64_t generation, std::string_view request, bool& shutdown);
+
+// Принимает соединения на socket_path (старый файл сокета удаляется) и обслуживает их по одному,
+// пока не придёт SHUTDOWN. Путь длиннее sun_path - invalid_argument, ошибки сокета и занятый
+// другим файлом путь - runtime_error.
+// Документы хранятся только в памяти процесса: перезапущенный шард пуст и отвечает на HELLO новым поколением,
+// по которому координатор замечает потерю документов (MultiProcessSearchServer::AcceptShardRestart).
+void ServeShard(const std::string& socket_path, std::string_view stop_words_text, SearchServerOptions options = {});
+
+// Параметры процесса search_shard и их запись в командной строке:
+//   --socket ПУТЬ [--stop-words "and in"] [--positional-index] [--max-prefix-expansions N] [--max-fuzzy-expansions N]
+//   [--fuzzy-penalty X] [--suggest-cache-size N] [--float-postings] [--no-pooled-allocation] [--no-forward-index]
+struct ShardArguments {
+    std::string socket_path;
+    std::string stop_words_text;
+    SearchServerOptions options;
+};
+
+// аргументы без имени программы
+std::vector<std::string> MakeShardArguments(const ShardArguments& shard);
+// неизвестный параметр, параметр без значения, некорректное число или отсутствие --socket - invalid_argument
+ShardArguments ParseShardArguments(const std::vector<std::string_view>& arguments);
+
+// Процесс шарда: fork и execv исполняемого файла search_shard (shard_executable) с аргументами MakeShardArguments.
+// Если файл не запускается, конструктор и Restart выбрасывают runtime_error. Деструктор останавливает процесс.
+class ShardProcess {
+public:
+    ShardProcess(std::string shard_executable, std::string socket_path, std::string stop_words_text, SearchServerOptions options = {});
+    ~ShardProcess();
+
+    ShardProcess(const ShardProcess&) = delete;
+    ShardProcess& operator=(const ShardProcess&) = delete;
+
+    // SIGTERM и ожидание завершения; файл сокета удаляется
+    void Stop();
+    // Stop и новый процесс на том же сокете, с пустым индексом
+    void Restart();
+
+    pid_t GetPid() const;
+    const std::string& GetSocketPath() const;
+
+private:
+    void Start();
+
+    std::string shard_executable_;
+    ShardArguments arguments_;
+    pid_t pid_ = -1;
+};
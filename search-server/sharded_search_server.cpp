@@ -0,0 +1,106 @@
+#include "sharded_search_server.h"
+
+#include <cstdint>
+#include <mutex>
+
+using namespace std;
+
+size_t ComputeShardIndex(int document_id, size_t shard_count) {
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((hash >> 32) % shard_count);
+}
+
+vector<Document> MergeTopDocuments(const vector<vector<Document>>& shard_documents) {
+    //лучшие документы корпуса - среди лучших документов шардов
+    vector<Document> documents;
+    for (const auto& current : shard_documents) {
+        documents.insert(documents.end(), current.begin(), current.end());
+    }
+    sort(documents.begin(), documents.end(), greater<Document>());
+    if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return documents;
+}
+
+ShardedSearchServer::Shard::Shard(const string_view stop_words_text, SearchServerOptions options)
+    : server(stop_words_text, options) {
+}
+
+ShardedSearchServer::ShardedSearchServer(const string_view stop_words_text, size_t shard_count, SearchServerOptions options) {
+    if (shard_count == 0) {
+        throw invalid_argument("Shard count must be positive"s);
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(make_unique<Shard>(stop_words_text, options));
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int>& ratings) {
+    //отрицательный или уже занятый id отвергает сам шард: документ с этим id может быть только в нём
+    Shard& shard = *shards_[GetShardIndex(document_id)];
+    const unique_lock lock(shard.mutex);
+    shard.server.AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    Shard& shard = *shards_[GetShardIndex(document_id)];
+    const unique_lock lock(shard.mutex);
+    shard.server.RemoveDocument(document_id);
+}
+
+size_t ShardedSearchServer::GetDocumentCount() const {
+    size_t document_count = 0;
+    for (const auto& shard : shards_) {
+        const shared_lock lock(shard->mutex);
+        document_count += shard->server.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    return ComputeShardIndex(document_id, shards_.size());
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(const string_view raw_query) const {
+    return FindTopDocuments(execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
+
+MatchOfDocument ShardedSearchServer::MatchDocument(const string_view raw_query, int document_id) const {
+    const Shard& shard = *shards_[GetShardIndex(document_id)];
+    const shared_lock lock(shard.mutex);
+    return shard.server.MatchDocument(raw_query, document_id);
+}
+
+map<string_view, double> ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    const Shard& shard = *shards_[GetShardIndex(document_id)];
+    const shared_lock lock(shard.mutex);
+    return shard.server.GetWordFrequencies(document_id);
+}
+
+vector<shared_lock<shared_mutex>> ShardedSearchServer::LockAllShared() const {
+    //по порядку шардов; изменения блокируют только один шард, поэтому взаимной блокировки нет
+    vector<shared_lock<shared_mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        locks.emplace_back(shard->mutex);
+    }
+    return locks;
+}
+
+CorpusStatistics ShardedSearchServer::CollectCorpusStatistics(const string_view raw_query) const {
+    vector<CorpusStatistics> shard_statistics(shards_.size());
+    ForEachShard([this, raw_query, &shard_statistics](size_t index) {
+        shard_statistics[index] = shards_[index]->server.CollectCorpusStatistics(raw_query);
+    });
+    CorpusStatistics corpus;
+    for (const auto& statistics : shard_statistics) {
+        corpus.Merge(statistics);
+    }
+    return corpus;
+}
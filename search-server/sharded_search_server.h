@@ -0,0 +1,97 @@
+#pragma once
+#include <algorithm>
+#include <exception>
+#include <execution>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+// шард документа среди shard_count: мультипликативный хеш, id с шагом, кратным числу шардов, не собираются в одном шарде
+size_t ComputeShardIndex(int document_id, size_t shard_count);
+// лучшие MAX_RESULT_DOCUMENT_COUNT документов из выдач шардов с общей статистикой корпуса
+std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>>& shard_documents);
+
+// Индекс, разбитый по хешу id документа на shard_count независимых SearchServer.
+// AddDocument и RemoveDocument блокируют только шард документа и идут параллельно с изменениями других шардов.
+// Поиск в две фазы: шарды параллельно собирают статистику слов запроса, её сумма - статистика всего корпуса;
+// затем шарды параллельно ищут лучшие документы с этой статистикой, их выдачи сливаются.
+// Поэтому релевантность та же, что у одного SearchServer со всеми документами. Исключение - префиксы и слова
+// с опечатками, раскрывающиеся в большее число слов, чем разрешают SearchServerOptions: шард выбирает слова по своему словарю.
+class ShardedSearchServer {
+public:
+    ShardedSearchServer(const std::string_view stop_words_text, size_t shard_count, SearchServerOptions options = {});
+
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    size_t GetDocumentCount() const;
+    size_t GetShardCount() const;
+    // номер шарда, которому принадлежит документ
+    size_t GetShardIndex(int document_id) const;
+
+    //scorer - функция ранжирования из scoring; policy передаётся поиску в каждом шарде, сами шарды обходятся параллельно
+    template <typename ExecutionPolicy, typename PredicateStatus, typename Scorer = scoring::TfIdf>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, PredicateStatus predicate_status, Scorer scorer = {}) const {
+        //обе фазы под одной блокировкой: статистика первой фазы описывает те же документы, что ищет вторая
+        const auto locks = LockAllShared();
+        const CorpusStatistics corpus = CollectCorpusStatistics(raw_query);
+        const scoring::WithCorpusStatistics<Scorer> corpus_scorer(scorer, corpus);
+        std::vector<std::vector<Document>> shard_documents(shards_.size());
+        ForEachShard([&](size_t index) {
+            shard_documents[index] = shards_[index]->server.FindTopDocuments(policy, raw_query, predicate_status, corpus_scorer);
+        });
+        return MergeTopDocuments(shard_documents);
+    }
+
+    template <typename PredicateStatus>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, PredicateStatus predicate_status) const {
+        return FindTopDocuments(std::execution::seq, raw_query, predicate_status);
+    }
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+    MatchOfDocument MatchDocument(const std::string_view raw_query, int document_id) const;
+    // строки слов живут вместе с шардом
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+private:
+    struct Shard {
+        Shard(const std::string_view stop_words_text, SearchServerOptions options);
+
+        mutable std::shared_mutex mutex;
+        SearchServer server;
+    };
+
+    std::vector<std::shared_lock<std::shared_mutex>> LockAllShared() const;
+    //вызывающий держит блокировки всех шардов
+    CorpusStatistics CollectCorpusStatistics(const std::string_view raw_query) const;
+
+    //function(номер шарда) для всех шардов параллельно; исключение из параллельного алгоритма вызвало бы
+    //std::terminate, поэтому исключения шардов перехватываются и первое из них выбрасывается в вызывающем потоке
+    template <typename Function>
+    void ForEachShard(Function function) const {
+        std::vector<size_t> indexes(shards_.size());
+        std::iota(indexes.begin(), indexes.end(), 0);
+        std::vector<std::exception_ptr> errors(shards_.size());
+        std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&function, &errors](size_t index) {
+            try {
+                function(index);
+            }
+            catch (...) {
+                errors[index] = std::current_exception();
+            }
+        });
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
@@ -7,20 +7,27 @@
 using namespace std;
 //  ,    
 std::vector<std::string_view> SplitIntoWordsView(const string_view text) {
+    std::vector<std::string_view> words;
+    if (!SplitIntoWordsView(text, words)) {
+        throw std::invalid_argument("Word "s + string(text) + " is invalid"s);
+    }
+    return words;
+}
 
+//   words  ,  words 
+bool SplitIntoWordsView(const string_view text, std::vector<std::string_view>& words) {
+    words.clear();
     if (any_of(text.begin(), text.end(), [](auto& c) {
         return c < ' ' && c >= '\0';
-        })) throw std::invalid_argument("Word "s + string(text) + " is invalid"s);
-
+        })) return false;
 
-        std::vector<std::string_view> words;
-        size_t start = text.find_first_not_of(' ');
-        while (start != string_view::npos) {
-            size_t end = text.find(' ', start);
-            words.push_back(text.substr(start, end - start));
-            start = text.find_first_not_of(' ', end);
-        }
-        return words;
+    size_t start = text.find_first_not_of(' ');
+    while (start != string_view::npos) {
+        size_t end = text.find(' ', start);
+        words.push_back(text.substr(start, end - start));
+        start = text.find_first_not_of(' ', end);
+    }
+    return true;
 }
 
 //.   
@@ -3,3 +3,5 @@
 #include <vector>
 
 std::vector<std::string_view> SplitIntoWordsView(const std::string_view text);
+// без исключений и выделения памяти при достаточной ёмкости words; false - в тексте есть спецсимволы
+bool SplitIntoWordsView(const std::string_view text, std::vector<std::string_view>& words);
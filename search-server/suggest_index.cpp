@@ -0,0 +1,163 @@
+#include <algorithm>
+#include "suggest_index.h"
+
+using namespace std;
+
+SuggestIndex::SuggestIndex(size_t cache_size, pmr::memory_resource* resource)
+    : nodes_(resource)
+    , words_(resource)
+    , document_counts_(resource)
+    , cache_size_(max<size_t>(cache_size, 1)) {
+    nodes_.emplace_back();
+}
+
+void SuggestIndex::Update(string_view word, size_t document_count) {
+    vector<NodeIndex> path;
+    path.reserve(word.size() + 1);
+    path.push_back(0);
+    for (const char symbol : word) {
+        const unsigned char byte = static_cast<unsigned char>(symbol);
+        auto& children = nodes_[path.back()].children;
+        auto it = lower_bound(children.begin(), children.end(), byte,
+            [](const auto& child, unsigned char value) { return child.first < value; });
+        NodeIndex child;
+        if (it != children.end() && it->first == byte) {
+            child = it->second;
+        }
+        else {
+            child = static_cast<NodeIndex>(nodes_.size());
+            children.insert(it, { byte, child });
+            nodes_.emplace_back(); //после этого children и it недействительны
+        }
+        path.push_back(child);
+    }
+
+    WordIndex& word_index = nodes_[path.back()].word;
+    if (word_index == NO_WORD) {
+        if (document_count == 0) {
+            return;
+        }
+        word_index = static_cast<WordIndex>(words_.size());
+        words_.emplace_back(word);
+        document_counts_.push_back(0);
+    }
+    const WordIndex index = word_index;
+    const size_t old_count = document_counts_[index];
+    if (old_count == document_count) {
+        return;
+    }
+    document_counts_[index] = document_count;
+
+    const auto better = [this](WordIndex lhs, WordIndex rhs) { return IsBetter(lhs, rhs); };
+    //от листа к корню: списки потомков к моменту обработки предка уже верны
+    for (auto node = path.rbegin(); node != path.rend(); ++node) {
+        auto& top = nodes_[*node].top;
+        const auto it = find(top.begin(), top.end(), index);
+        const bool in_top = it != top.end();
+        if (document_count > old_count) {
+            if (in_top) {
+                top.erase(it);
+            }
+            else if (top.size() == cache_size_ && !IsBetter(index, top.back())) {
+                break; //не попало в список потомка - не попадёт и в списки предков
+            }
+            top.insert(upper_bound(top.begin(), top.end(), index, better), index);
+            if (top.size() > cache_size_) {
+                top.pop_back();
+            }
+        }
+        else {
+            if (!in_top) {
+                break;
+            }
+            if (top.size() < cache_size_) {
+                //в неполном списке все слова поддерева, достаточно переставить
+                top.erase(it);
+                if (document_count > 0) {
+                    top.insert(upper_bound(top.begin(), top.end(), index, better), index);
+                }
+            }
+            else {
+                //на освободившееся место может претендовать слово вне списка
+                RebuildTop(*node);
+            }
+        }
+    }
+}
+
+vector<string_view> SuggestIndex::Suggest(string_view prefix, size_t k) const {
+    vector<string_view> result;
+    const NodeIndex node = FindNode(prefix);
+    if (node == NO_NODE || k == 0) {
+        return result;
+    }
+    const auto& top = nodes_[node].top;
+    if (k <= top.size() || top.size() < cache_size_) {
+        const size_t count = min(k, top.size());
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            result.emplace_back(words_[top[i]]);
+        }
+        return result;
+    }
+    //запрошено больше, чем хранится в узле, - обходим поддерево
+    vector<WordIndex> words;
+    CollectWords(node, words);
+    const size_t count = min(k, words.size());
+    partial_sort(words.begin(), words.begin() + count, words.end(),
+        [this](WordIndex lhs, WordIndex rhs) { return IsBetter(lhs, rhs); });
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        result.emplace_back(words_[words[i]]);
+    }
+    return result;
+}
+
+bool SuggestIndex::IsBetter(WordIndex lhs, WordIndex rhs) const {
+    if (document_counts_[lhs] != document_counts_[rhs]) {
+        return document_counts_[lhs] > document_counts_[rhs];
+    }
+    return words_[lhs] < words_[rhs];
+}
+
+SuggestIndex::NodeIndex SuggestIndex::FindNode(string_view prefix) const {
+    NodeIndex node = 0;
+    for (const char symbol : prefix) {
+        const unsigned char byte = static_cast<unsigned char>(symbol);
+        const auto& children = nodes_[node].children;
+        const auto it = lower_bound(children.begin(), children.end(), byte,
+            [](const auto& child, unsigned char value) { return child.first < value; });
+        if (it == children.end() || it->first != byte) {
+            return NO_NODE;
+        }
+        node = it->second;
+    }
+    return node;
+}
+
+void SuggestIndex::RebuildTop(NodeIndex node) {
+    pmr::vector<WordIndex> candidates(nodes_[node].top.get_allocator());
+    const WordIndex word = nodes_[node].word;
+    if (word != NO_WORD && document_counts_[word] > 0) {
+        candidates.push_back(word);
+    }
+    for (const auto& [byte, child] : nodes_[node].children) {
+        const auto& child_top = nodes_[child].top;
+        candidates.insert(candidates.end(), child_top.begin(), child_top.end());
+    }
+    const size_t count = min(cache_size_, candidates.size());
+    partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+        [this](WordIndex lhs, WordIndex rhs) { return IsBetter(lhs, rhs); });
+    candidates.resize(count);
+    nodes_[node].top = move(candidates);
+}
+
+void SuggestIndex::CollectWords(NodeIndex node, vector<WordIndex>& words) const {
+    const WordIndex word = nodes_[node].word;
+    if (word != NO_WORD && document_counts_[word] > 0) {
+        words.push_back(word);
+    }
+    for (const auto& [byte, child] : nodes_[node].children) {
+        CollectWords(child, words);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Индекс автодополнения: префиксное дерево по байтам слов словаря, в каждом узле заранее
+// посчитаны cache_size лучших слов поддерева (по числу документов со словом, при равенстве - по алфавиту).
+// Подсказка по префиксу - спуск по префиксу и чтение готового списка узла.
+// Узлы и слова не удаляются: исчезнувшее слово получает вес 0 и переиспользуется при повторном добавлении.
+class SuggestIndex {
+public:
+    // память узлов и слов берётся из resource
+    explicit SuggestIndex(size_t cache_size = 10, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // число документов со словом стало document_count, 0 - слово исчезло из словаря
+    void Update(std::string_view word, size_t document_count);
+
+    // до k слов, начинающихся с prefix, лучшие первыми; строки живут вместе с индексом
+    std::vector<std::string_view> Suggest(std::string_view prefix, size_t k) const;
+
+private:
+    using NodeIndex = uint32_t;
+    using WordIndex = uint32_t;
+    static constexpr WordIndex NO_WORD = UINT32_MAX;
+    static constexpr NodeIndex NO_NODE = UINT32_MAX;
+
+    //списки узла берут память у того же ресурса, что и nodes_
+    struct Node {
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+        explicit Node(const allocator_type& allocator)
+            : children(allocator)
+            , top(allocator) {
+        }
+        Node(const Node& other, const allocator_type& allocator)
+            : children(other.children, allocator)
+            , word(other.word)
+            , top(other.top, allocator) {
+        }
+        Node(Node&& other, const allocator_type& allocator)
+            : children(std::move(other.children), allocator)
+            , word(other.word)
+            , top(std::move(other.top), allocator) {
+        }
+        Node(const Node&) = default;
+        Node(Node&&) = default;
+        Node& operator=(const Node&) = default;
+        Node& operator=(Node&&) = default;
+
+        std::pmr::vector<std::pair<unsigned char, NodeIndex>> children; //по возрастанию байта
+        WordIndex word = NO_WORD; //слово, заканчивающееся в узле
+        std::pmr::vector<WordIndex> top; //лучшие слова поддерева, не больше cache_size_
+    };
+
+    std::pmr::vector<Node> nodes_;
+    std::pmr::deque<std::pmr::string> words_; //deque: адреса строк не меняются при добавлении
+    std::pmr::vector<size_t> document_counts_;
+    size_t cache_size_;
+
+    bool IsBetter(WordIndex lhs, WordIndex rhs) const;
+    //NO_NODE, если слов с таким префиксом не было
+    NodeIndex FindNode(std::string_view prefix) const;
+    void RebuildTop(NodeIndex node);
+    void CollectWords(NodeIndex node, std::vector<WordIndex>& words) const;
+};
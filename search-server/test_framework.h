@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::string_literals;
+
+template <typename First, typename Second>
+std::ostream& operator<<(std::ostream& out, const std::pair<First, Second>& container);
+
+template <typename Container>
+void PrintRange(std::ostream& out, const Container& container, const std::string& open, const std::string& close) {
+    out << open;
+    bool is_first = true;
+    for (const auto& element : container) {
+        if (!is_first) {
+            out << ", "s;
+        }
+        is_first = false;
+        out << element;
+    }
+    out << close;
+}
+
+template <typename Element>
+std::ostream& operator<<(std::ostream& out, const std::vector<Element>& container) {
+    PrintRange(out, container, "["s, "]"s);
+    return out;
+}
+
+template <typename Element>
+std::ostream& operator<<(std::ostream& out, const std::set<Element>& container) {
+    PrintRange(out, container, "{"s, "}"s);
+    return out;
+}
+
+template <typename Key, typename Value>
+std::ostream& operator<<(std::ostream& out, const std::map<Key, Value>& container) {
+    PrintRange(out, container, "{"s, "}"s);
+    return out;
+}
+
+template <typename First, typename Second>
+std::ostream& operator<<(std::ostream& out, const std::pair<First, Second>& container) {
+    return out << container.first << ": "s << container.second;
+}
+
+template <typename T, typename U>
+void AssertEqualImpl(const T& t, const U& u, const std::string& t_str, const std::string& u_str, const std::string& file,
+    const std::string& func, unsigned line, const std::string& hint) {
+    if (!(t == u)) {
+        std::cerr << std::boolalpha;
+        std::cerr << file << "("s << line << "): "s << func << ": "s;
+        std::cerr << "ASSERT_EQUAL("s << t_str << ", "s << u_str << ") failed: "s;
+        std::cerr << t << " != "s << u << "."s;
+        if (!hint.empty()) {
+            std::cerr << " Hint: "s << hint;
+        }
+        std::cerr << std::endl;
+        std::abort();
+    }
+}
+
+#define ASSERT_EQUAL(a, b) AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, ""s)
+
+#define ASSERT_EQUAL_HINT(a, b, hint) AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+inline void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func, unsigned line,
+    const std::string& hint) {
+    if (!value) {
+        std::cerr << file << "("s << line << "): "s << func << ": "s;
+        std::cerr << "ASSERT("s << expr_str << ") failed."s;
+        if (!hint.empty()) {
+            std::cerr << " Hint: "s << hint;
+        }
+        std::cerr << std::endl;
+        std::abort();
+    }
+}
+
+#define ASSERT(expr) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, ""s)
+
+#define ASSERT_HINT(expr, hint) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+template <typename TestFunc>
+void RunTestImpl(const TestFunc& func, const std::string& test_name) {
+    func();
+    std::cerr << test_name << " OK"s << std::endl;
+}
+
+#define RUN_TEST(func) RunTestImpl((func), #func)
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include "trace.h"
+
+using namespace std;
+
+namespace trace {
+    namespace {
+        // Буфер одного потока. Пишет только владелец, читают сборщики: поля - атомарные,
+        // поэтому чтение во время записи даёт, в худшем случае, смесь старого и нового события, но не гонку данных.
+        struct ThreadBuffer {
+            struct Slot {
+                atomic<const char*> name{ nullptr };
+                atomic<uint8_t> phase{ 0 };
+                atomic<uint64_t> start_ns{ 0 };
+                atomic<uint64_t> duration_ns{ 0 };
+            };
+
+            uint32_t thread_index = 0;
+            //поток завершился, записей больше не будет; меняется под buffers_mutex
+            bool exited = false;
+            atomic<uint64_t> event_count{ 0 };
+            array<Slot, EVENTS_PER_THREAD> events;
+            array<atomic<uint64_t>, PHASE_COUNT> phase_counts{};
+            array<atomic<uint64_t>, PHASE_COUNT> phase_total_ns{};
+        };
+
+        // буферы переживают свои потоки, чтобы их события попали в выгрузку, но не дольше первого CollectEvents
+        // и не больше MAX_EXITED_THREAD_BUFFERS; счётчики освобождённых буферов копятся в released_phase_stats
+        struct Registry {
+            mutex buffers_mutex;
+            vector<shared_ptr<ThreadBuffer>> buffers;
+            array<PhaseStats, PHASE_COUNT> released_phase_stats{};
+            uint32_t next_thread_index = 0;
+        };
+
+        Registry& GetRegistry() {
+            static Registry registry;
+            return registry;
+        }
+
+        //вызывается под buffers_mutex
+        void ReleaseBuffer(Registry& registry, vector<shared_ptr<ThreadBuffer>>::iterator it) {
+            const ThreadBuffer& buffer = **it;
+            for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+                registry.released_phase_stats[phase].count += buffer.phase_counts[phase].load(memory_order_relaxed);
+                registry.released_phase_stats[phase].total_ns += buffer.phase_total_ns[phase].load(memory_order_relaxed);
+            }
+            registry.buffers.erase(it);
+        }
+
+        // буфер потока; при завершении потока помечается завершённым, лишние буферы завершившихся потоков освобождаются
+        class ThreadBufferOwner {
+        public:
+            ThreadBufferOwner()
+                : buffer_(make_shared<ThreadBuffer>()) {
+                Registry& registry = GetRegistry();
+                lock_guard guard(registry.buffers_mutex);
+                buffer_->thread_index = registry.next_thread_index++;
+                registry.buffers.push_back(buffer_);
+            }
+
+            ~ThreadBufferOwner() {
+                Registry& registry = GetRegistry();
+                lock_guard guard(registry.buffers_mutex);
+                buffer_->exited = true;
+                const size_t exited_count = count_if(registry.buffers.begin(), registry.buffers.end(), [](const auto& buffer) {
+                    return buffer->exited;
+                });
+                if (exited_count > MAX_EXITED_THREAD_BUFFERS) {
+                    //буферы в порядке создания потоков: первый завершённый - самый старый
+                    ReleaseBuffer(registry, find_if(registry.buffers.begin(), registry.buffers.end(), [](const auto& buffer) {
+                        return buffer->exited;
+                    }));
+                }
+            }
+
+            ThreadBufferOwner(const ThreadBufferOwner&) = delete;
+            ThreadBufferOwner& operator=(const ThreadBufferOwner&) = delete;
+
+            ThreadBuffer& Get() {
+                return *buffer_;
+            }
+
+        private:
+            shared_ptr<ThreadBuffer> buffer_;
+        };
+
+        ThreadBuffer& GetThreadBuffer() {
+            thread_local ThreadBufferOwner owner;
+            return owner.Get();
+        }
+
+        vector<shared_ptr<ThreadBuffer>> GetBuffers() {
+            Registry& registry = GetRegistry();
+            lock_guard guard(registry.buffers_mutex);
+            return registry.buffers;
+        }
+
+        const chrono::steady_clock::time_point PROGRAM_START = chrono::steady_clock::now();
+
+        void WriteJsonString(ostream& out, const char* text) {
+            out << '"';
+            for (; *text != '\0'; ++text) {
+                if (*text == '"' || *text == '\\') {
+                    out << '\\';
+                }
+                out << *text;
+            }
+            out << '"';
+        }
+    }
+
+    namespace detail {
+        atomic<bool> enabled{ false };
+
+        uint64_t NowNs() {
+            return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - PROGRAM_START).count());
+        }
+
+        void Record(const char* name, Phase phase, uint64_t start_ns, uint64_t duration_ns) {
+            ThreadBuffer& buffer = GetThreadBuffer();
+            const size_t phase_index = static_cast<size_t>(phase);
+            //единственный писатель: load + store дешевле атомарного сложения
+            buffer.phase_counts[phase_index].store(buffer.phase_counts[phase_index].load(memory_order_relaxed) + 1, memory_order_relaxed);
+            buffer.phase_total_ns[phase_index].store(buffer.phase_total_ns[phase_index].load(memory_order_relaxed) + duration_ns, memory_order_relaxed);
+
+            const uint64_t index = buffer.event_count.load(memory_order_relaxed);
+            auto& slot = buffer.events[index % EVENTS_PER_THREAD];
+            slot.name.store(name, memory_order_relaxed);
+            slot.phase.store(static_cast<uint8_t>(phase), memory_order_relaxed);
+            slot.start_ns.store(start_ns, memory_order_relaxed);
+            slot.duration_ns.store(duration_ns, memory_order_relaxed);
+            buffer.event_count.store(index + 1, memory_order_release);
+        }
+    }
+
+    const char* GetPhaseName(Phase phase) {
+        switch (phase) {
+        case Phase::REQUEST: return "request";
+        case Phase::PARSE: return "parse";
+        case Phase::LOOKUP: return "lookup";
+        case Phase::SCORE: return "score";
+        case Phase::MINUS_FILTER: return "minus_filter";
+        case Phase::TOP_K: return "top_k";
+        case Phase::MATCH: return "match";
+        }
+        return "unknown";
+    }
+
+    void SetEnabled(bool enabled) {
+        detail::enabled.store(enabled, memory_order_relaxed);
+    }
+
+    array<PhaseStats, PHASE_COUNT> GetPhaseStats() {
+        Registry& registry = GetRegistry();
+        //под блокировкой: иначе буфер, освобождённый во время подсчёта, не попал бы в сумму или попал бы в неё дважды
+        lock_guard guard(registry.buffers_mutex);
+        array<PhaseStats, PHASE_COUNT> result = registry.released_phase_stats;
+        for (const auto& buffer : registry.buffers) {
+            for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+                result[phase].count += buffer->phase_counts[phase].load(memory_order_relaxed);
+                result[phase].total_ns += buffer->phase_total_ns[phase].load(memory_order_relaxed);
+            }
+        }
+        return result;
+    }
+
+    vector<Event> CollectEvents() {
+        Registry& registry = GetRegistry();
+        vector<shared_ptr<ThreadBuffer>> buffers;
+        vector<shared_ptr<ThreadBuffer>> exited_buffers;
+        {
+            lock_guard guard(registry.buffers_mutex);
+            buffers = registry.buffers;
+            copy_if(buffers.begin(), buffers.end(), back_inserter(exited_buffers), [](const auto& buffer) {
+                return buffer->exited;
+            });
+        }
+        vector<Event> events;
+        for (const auto& buffer : buffers) {
+            const uint64_t count = buffer->event_count.load(memory_order_acquire);
+            const uint64_t first = count > EVENTS_PER_THREAD ? count - EVENTS_PER_THREAD : 0;
+            for (uint64_t index = first; index < count; ++index) {
+                const auto& slot = buffer->events[index % EVENTS_PER_THREAD];
+                const char* name = slot.name.load(memory_order_relaxed);
+                if (name == nullptr) {
+                    continue;
+                }
+                events.push_back({ name, static_cast<Phase>(slot.phase.load(memory_order_relaxed)), buffer->thread_index,
+                    slot.start_ns.load(memory_order_relaxed), slot.duration_ns.load(memory_order_relaxed) });
+            }
+        }
+        {
+            //события завершившихся потоков собраны целиком, их буферы больше не нужны
+            lock_guard guard(registry.buffers_mutex);
+            for (const auto& buffer : exited_buffers) {
+                //параллельный CollectEvents мог освободить буфер раньше
+                if (const auto it = find(registry.buffers.begin(), registry.buffers.end(), buffer); it != registry.buffers.end()) {
+                    ReleaseBuffer(registry, it);
+                }
+            }
+        }
+        sort(events.begin(), events.end(), [](const Event& lhs, const Event& rhs) {
+            return lhs.start_ns < rhs.start_ns;
+        });
+        return events;
+    }
+
+    void WriteChromeTrace(ostream& out) {
+        //ts и dur - в микросекундах, дробная часть сохраняет наносекунды
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":["sv;
+        bool first = true;
+        for (const Event& event : CollectEvents()) {
+            if (!first) {
+                out << ',';
+            }
+            first = false;
+            out << "{\"name\":"sv;
+            WriteJsonString(out, event.name);
+            out << ",\"cat\":\""sv << GetPhaseName(event.phase) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"sv << event.thread_index
+                << ",\"ts\":"sv << event.start_ns / 1000 << '.' << event.start_ns % 1000 / 100 << event.start_ns % 100 / 10 << event.start_ns % 10
+                << ",\"dur\":"sv << event.duration_ns / 1000 << '.' << event.duration_ns % 1000 / 100 << event.duration_ns % 100 / 10 << event.duration_ns % 10
+                << '}';
+        }
+        out << "]}"sv;
+    }
+
+    void Reset() {
+        Registry& registry = GetRegistry();
+        {
+            lock_guard guard(registry.buffers_mutex);
+            registry.buffers.erase(remove_if(registry.buffers.begin(), registry.buffers.end(), [](const auto& buffer) {
+                return buffer->exited;
+            }), registry.buffers.end());
+            registry.released_phase_stats = {};
+        }
+        for (const auto& buffer : GetBuffers()) {
+            buffer->event_count.store(0, memory_order_relaxed);
+            for (auto& slot : buffer->events) {
+                slot.name.store(nullptr, memory_order_relaxed);
+            }
+            for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+                buffer->phase_counts[phase].store(0, memory_order_relaxed);
+                buffer->phase_total_ns[phase].store(0, memory_order_relaxed);
+            }
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Трассировка горячего пути. TRACE_SCOPE("имя", ФАЗА) замеряет время до конца блока в наносекундах и пишет событие
+// в кольцевой буфер своего потока, а длительность - в счётчики фазы этого потока; блокировок при записи нет.
+// Счётчики и события всех потоков собираются только при чтении. Области вкладываются: время вложенной
+// входит и во внешнюю, так фаза REQUEST охватывает все остальные фазы запроса. Запись включается trace::SetEnabled(true),
+// выключенная трассировка стоит одной проверки флага. С SEARCH_SERVER_DISABLE_TRACING макрос исчезает совсем.
+//
+//  std::vector<Document> Find(...) {
+//      TRACE_SCOPE("Find", REQUEST);
+//      ...
+//  }
+namespace trace {
+    enum class Phase : uint8_t {
+        REQUEST,      //запрос целиком
+        PARSE,        //разбор запроса
+        LOOKUP,       //поиск слов в словаре, раскрытие префиксов и опечаток
+        SCORE,        //подсчёт релевантностей
+        MINUS_FILTER, //отбрасывание документов с минус-словами
+        TOP_K,        //отбор и сортировка лучших документов
+        MATCH,        //MatchDocument
+    };
+    inline constexpr size_t PHASE_COUNT = static_cast<size_t>(Phase::MATCH) + 1;
+
+    const char* GetPhaseName(Phase phase);
+
+    struct Event {
+        const char* name; //строковый литерал из TRACE_SCOPE
+        Phase phase;
+        uint32_t thread_index;
+        uint64_t start_ns; //от начала работы программы
+        uint64_t duration_ns;
+    };
+
+    struct PhaseStats {
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+    };
+
+    // событий в буфере потока, более старые перезаписываются
+    inline constexpr size_t EVENTS_PER_THREAD = 4096;
+    // буферов завершившихся потоков, ждущих CollectEvents; при превышении освобождается самый старый, и его события теряются
+    inline constexpr size_t MAX_EXITED_THREAD_BUFFERS = 32;
+
+    void SetEnabled(bool enabled);
+
+    namespace detail {
+        extern std::atomic<bool> enabled;
+        uint64_t NowNs();
+        void Record(const char* name, Phase phase, uint64_t start_ns, uint64_t duration_ns);
+    }
+
+    inline bool IsEnabled() {
+        return detail::enabled.load(std::memory_order_relaxed);
+    }
+
+    // суммы по всем потокам
+    std::array<PhaseStats, PHASE_COUNT> GetPhaseStats();
+    // события из буферов всех потоков по времени начала; пока потоки пишут, самые старые события могут быть уже перезаписаны.
+    // Буферы завершившихся потоков после сбора освобождаются: их события выгружаются один раз, а счётчики остаются в GetPhaseStats
+    std::vector<Event> CollectEvents();
+    // события в формате Trace Event JSON: открывается в chrome://tracing и Perfetto
+    void WriteChromeTrace(std::ostream& out);
+    // обнуляет счётчики и буферы; вызывать, когда трассируемая работа не идёт
+    void Reset();
+
+    class Scope {
+    public:
+        Scope(const char* name, Phase phase)
+            : name_(name)
+            , phase_(phase)
+            , start_ns_(IsEnabled() ? detail::NowNs() : NOT_STARTED) {
+        }
+
+        ~Scope() {
+            if (start_ns_ != NOT_STARTED) {
+                detail::Record(name_, phase_, start_ns_, detail::NowNs() - start_ns_);
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        static constexpr uint64_t NOT_STARTED = UINT64_MAX;
+
+        const char* name_;
+        Phase phase_;
+        uint64_t start_ns_;
+    };
+}
+
+#define TRACE_CONCAT_INTERNAL(X, Y) X##Y
+#define TRACE_CONCAT(X, Y) TRACE_CONCAT_INTERNAL(X, Y)
+
+#if defined(SEARCH_SERVER_DISABLE_TRACING)
+#define TRACE_SCOPE(name, phase) ((void)0)
+#else
+#define TRACE_SCOPE(name, phase) ::trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name, ::trace::Phase::phase)
+#endif